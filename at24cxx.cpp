@@ -8,6 +8,7 @@
 // Copyright   : MIT License 2024, John Greenwell
 //--------------------------------------------------------------------------------------------------------------------
 
+#include <string.h>
 #include "at24cxx.h"
 
 namespace PeripheralIO
@@ -40,6 +41,16 @@ AT24CXX::AT24CXX(HAL::I2C& i2c_bus, uint32_t chip, uint8_t chip_addr, uint8_t wp
 , _addr_ov_bits((uint8_t)((chip & 0xC0000000) >> 30))
 , _addr_size(0)
 , _mode(wp_pin)
+, _bus_hz(100000)
+#ifdef AT24CXX_DEFERRED_WRITE_CYCLE
+, _inflight_since(0)
+, _inflight_address(0)
+, _inflight_len(0)
+#endif
+#ifdef AT24CXX_TRACE
+, _trace_hook(0)
+, _trace_context(0)
+#endif
 { }
 
 void AT24CXX::init()
@@ -109,12 +120,198 @@ void AT24CXX::clearWriteProtect() const
     }
 }
 
-// Private: Hardware I2C Write Function
+bool AT24CXX::busy()
+{
+#ifdef AT24CXX_DEFERRED_WRITE_CYCLE
+    // One extra tick covers the partial millisecond in which the cycle began
+    if (_inflight_len && ((uint32_t)(HAL::millis() - _inflight_since) > EEPROM_WRITE_CYCLE_TIME_MS))
+        _inflight_len = 0;
+
+    return (0 != _inflight_len);
+#else
+    return false;
+#endif
+}
+
+void AT24CXX::sync()
+{
+#ifdef AT24CXX_DEFERRED_WRITE_CYCLE
+    uint32_t elapsed;
+
+    if (!_inflight_len)
+        return;
+
+    // Sampled once, so a tick between the check and the delay cannot wrap the remaining time
+    elapsed = HAL::millis() - _inflight_since;
+
+    if (elapsed <= EEPROM_WRITE_CYCLE_TIME_MS)
+        HAL::delay_ms(EEPROM_WRITE_CYCLE_TIME_MS + 1 - elapsed);
+
+    _inflight_len = 0;
+#endif
+}
+
+bool AT24CXX::beginWrite(AT24CXXJob& job, uint16_t address, uint8_t * vals, uint16_t len)
+{
+    job.op  = AT24CXX_JOB_NONE;
+    job.len = 0;
+
+    if (!_mode || ((uint32_t)(address + len) > _chip_size))
+        return false;
+
+    job.vals    = vals;
+    job.address = address;
+    job.source  = 0;
+    job.len     = len;
+    job.page    = writePageSize(len);
+    job.op      = AT24CXX_JOB_WRITE;
+    job.reverse = false;
+
+    return true;
+}
+
+bool AT24CXX::beginRead(AT24CXXJob& job, uint16_t address, uint8_t * vals, uint16_t len)
+{
+    job.op  = AT24CXX_JOB_NONE;
+    job.len = 0;
+
+    if (!_mode || ((uint32_t)(address + len) > _chip_size))
+        return false;
+
+    job.vals    = vals;
+    job.address = address;
+    job.source  = 0;
+    job.len     = len;
+    job.page    = _page_size;
+    job.op      = AT24CXX_JOB_READ;
+    job.reverse = false;
+
+    return true;
+}
+
+bool AT24CXX::beginCopy(AT24CXXJob& job, uint16_t dest, uint16_t source, uint16_t len)
+{
+    job.op  = AT24CXX_JOB_NONE;
+    job.len = 0;
+
+    if (!_mode || ((uint32_t)(dest + len) > _chip_size) || ((uint32_t)(source + len) > _chip_size))
+        return false;
+
+    job.vals    = 0;
+    job.address = dest;
+    job.source  = source;
+    job.len     = len;
+    job.page    = writePageSize(len);
+    job.op      = AT24CXX_JOB_COPY;
+    job.reverse = (dest > source) && ((uint32_t)dest < (uint32_t)(source + len));
+
+    return true;
+}
+
+bool AT24CXX::resume(AT24CXXJob& job, uint16_t max_steps)
+{
+    for (uint16_t i = 0; (i < max_steps) && !job.done(); i++)
+    {
+        // A transfer to a busy device would first wait out the rest of its write cycle
+        if (busy())
+            break;
+
+        if (!step(job))
+            return false;
+    }
+
+    return true;
+}
+
+bool AT24CXX::resumeFor(AT24CXXJob& job, uint32_t budget_us)
+{
+    uint32_t spent = 0;
+    uint32_t cost;
+
+    while (!job.done() && !busy())
+    {
+        cost = stepUs(job.op, nextChunk(job));
+
+        if (spent + cost > budget_us)
+            break;
+
+        if (!step(job))
+            return false;
+
+        spent += cost;
+    }
+
+    return true;
+}
+
+uint32_t AT24CXX::maxBlockingUs(uint8_t op, uint16_t steps) const
+{
+    uint8_t largest = _page_size;
+
+#if AT24CXX_I2C_WRITE_MAX < AT24CXX_MAX_PAGE_SIZE
+    // Short writes on split chips may exceed the sub-page, up to the HAL transfer limit
+    if ((AT24CXX_JOB_READ != op) && (_addr_bytes > 1) && (_page_size > AT24CXX_I2C_WRITE_MAX))
+        largest = AT24CXX_I2C_WRITE_MAX;
+#endif
+
+    return steps * stepUs(op, largest);
+}
+
+// Private: Write entry point for all public write methods
 bool AT24CXX::writeN(uint16_t address, uint8_t* vals, uint16_t len)
+{
+#ifdef AT24CXX_TRACE
+    uint32_t start  = HAL::micros();
+    bool     result = writeDevice(address, vals, len);
+
+    trace(EEPROM_TRACE_WRITE, address, len, start, result);
+
+    return result;
+#else
+    return writeDevice(address, vals, len);
+#endif
+}
+
+// Private: Read entry point for all public read methods
+bool AT24CXX::readN(uint16_t address, uint8_t* vals, uint16_t len)
+{
+#ifdef AT24CXX_TRACE
+    uint32_t start  = HAL::micros();
+    bool     result = readDevice(address, vals, len);
+
+    trace(EEPROM_TRACE_READ, address, len, start, result);
+
+    return result;
+#else
+    return readDevice(address, vals, len);
+#endif
+}
+
+#ifdef AT24CXX_TRACE
+// Private: Deliver trace event to installed hook
+void AT24CXX::trace(uint8_t op, uint16_t address, uint16_t len, uint32_t start, bool ok)
+{
+    EepromTraceEvent event;
+
+    if (!_trace_hook)
+        return;
+
+    event.timestamp_us = start;
+    event.duration_us  = HAL::micros() - start;
+    event.address      = address;
+    event.len          = len;
+    event.op           = op;
+    event.ok           = ok ? 1 : 0;
+
+    _trace_hook(_trace_context, event);
+}
+#endif
+
+// Private: Hardware I2C Write Function
+bool AT24CXX::writeDevice(uint16_t address, uint8_t* vals, uint16_t len)
 {
     bool     result = false;
     uint16_t bytes_sent;
-    uint8_t  i2c_addr;
     uint8_t  offset;
     uint8_t  page_size;
     uint16_t pages_req;
@@ -122,35 +319,20 @@ bool AT24CXX::writeN(uint16_t address, uint8_t* vals, uint16_t len)
 
     if (_mode && ((uint32_t)(address + len) <= _chip_size))
     {
-        page_size = _page_size;
-
-        if ((_addr_bytes > 1) && (len > 30))
-            page_size = 16; // AT24C32+ can only write 30 bytes at a time
-        
+        page_size  = writePageSize(len);
         bytes_sent = 0;
-        i2c_addr   = _chip_addr;
         offset     = address % page_size;
         pages_req  = (((len + offset - 1) / page_size) + 1);
 
         for (uint16_t i = 0; i < pages_req; i++)
         {
-            if (_addr_ov_bits)
-            {
-                i2c_addr = ((uint8_t)((_chip_addr & 0xF8) | (((address + bytes_sent) & 0x0700) >> 8)));
-            }
-
             chunk = ((page_size - offset) < (len - bytes_sent)) ? (page_size - offset) : (len - bytes_sent);
 
-            if (_addr_bytes > 1)
-                if (0 != _i2c.write(i2c_addr, (uint16_t)(address + bytes_sent), &vals[bytes_sent], chunk))
-                    return false;
-            else
-                if (0 != _i2c.write(i2c_addr, (uint8_t)(address + bytes_sent), &vals[bytes_sent], chunk))
-                    return false;
+            if (!writeChunk((uint16_t)(address + bytes_sent), &vals[bytes_sent], chunk))
+                return false;
 
             bytes_sent += chunk;
             offset = 0;
-            HAL::delay_ms(EEPROM_WRITE_CYCLE_TIME_MS);
         }
         result = true;
     }
@@ -159,24 +341,40 @@ bool AT24CXX::writeN(uint16_t address, uint8_t* vals, uint16_t len)
 }
 
 // Private: Hardware I2C Read Function
-bool AT24CXX::readN(uint16_t address, uint8_t* vals, uint16_t len)
+bool AT24CXX::readDevice(uint16_t address, uint8_t* vals, uint16_t len)
 {
     bool    result   = false;
     uint8_t i2c_addr = _chip_addr;
 
     if (_mode && ((uint32_t)(address + len) <= _chip_size))
     {
+#ifdef AT24CXX_DEFERRED_WRITE_CYCLE
+        // Read-your-writes from the page still being programmed
+        if (busy() && (address >= _inflight_address) &&
+            ((uint32_t)(address + len) <= (uint32_t)(_inflight_address + _inflight_len)))
+        {
+            memcpy(vals, &_inflight[address - _inflight_address], len);
+            return true;
+        }
+#endif
+
+        sync();
+
         if (_addr_ov_bits)
         {
             i2c_addr = ((uint8_t)((_chip_addr & 0xF8) | (((address + 0) & 0x0700) >> 8)));
         }
 
-        if (_addr_bytes > 1) 
+        if (_addr_bytes > 1)
+        {
             if (0 != _i2c.writeRead(i2c_addr, (uint16_t)(address), vals, len))
                 return false;
+        }
         else
+        {
             if (0 != _i2c.writeRead(i2c_addr, (uint8_t)(address), vals, len))
                 return false;
+        }
 
         result = true;
     }
@@ -184,6 +382,159 @@ bool AT24CXX::readN(uint16_t address, uint8_t* vals, uint16_t len)
     return result;
 }
 
+// Private: Write one chunk lying within a page and start its write cycle
+bool AT24CXX::writeChunk(uint16_t address, uint8_t* vals, uint8_t len)
+{
+    uint8_t i2c_addr = _chip_addr;
+
+    if (_addr_ov_bits)
+    {
+        i2c_addr = ((uint8_t)((_chip_addr & 0xF8) | ((address & 0x0700) >> 8)));
+    }
+
+    sync();
+
+    if (_addr_bytes > 1)
+    {
+        if (0 != _i2c.write(i2c_addr, (uint16_t)address, vals, len))
+            return false;
+    }
+    else
+    {
+        if (0 != _i2c.write(i2c_addr, (uint8_t)address, vals, len))
+            return false;
+    }
+
+    beginWriteCycle(address, vals, len);
+
+    return true;
+}
+
+// Private: Chunk boundary for a write, splitting pages the HAL cannot send whole
+uint8_t AT24CXX::writePageSize(uint16_t len) const
+{
+    uint8_t page_size = _page_size;
+
+#if AT24CXX_I2C_WRITE_MAX < AT24CXX_MAX_PAGE_SIZE
+    // AT24C32+ writes are limited by the HAL transfer size; split into power-of-two sub-pages
+    if ((_addr_bytes > 1) && (len > AT24CXX_I2C_WRITE_MAX))
+    {
+        while (page_size > AT24CXX_I2C_WRITE_MAX)
+            page_size >>= 1;
+    }
+#else
+    (void)len;
+#endif
+
+    return page_size;
+}
+
+// Private: Length of the next step of a sliced operation
+uint8_t AT24CXX::nextChunk(const AT24CXXJob& job) const
+{
+    uint32_t last;
+    uint32_t first;
+
+    if (!job.reverse)
+        return (uint8_t)(((uint16_t)(job.page - job.address % job.page) < job.len) ?
+                         (job.page - job.address % job.page) : job.len);
+
+    // Reverse copies take chunks from the end, bounded by the destination's pages
+    last  = (uint32_t)job.address + job.len - 1;
+    first = last - last % job.page;
+
+    if (first < job.address)
+        first = job.address;
+
+    return (uint8_t)(last - first + 1);
+}
+
+// Private: Perform one step of a sliced operation
+bool AT24CXX::step(AT24CXXJob& job)
+{
+    uint8_t  buffer[AT24CXX_MAX_PAGE_SIZE];
+    uint8_t  chunk  = nextChunk(job);
+    uint16_t dest   = job.reverse ? (uint16_t)(job.address + job.len - chunk) : job.address;
+    uint16_t source = job.reverse ? (uint16_t)(job.source + job.len - chunk) : job.source;
+    bool     result;
+#ifdef AT24CXX_TRACE
+    uint32_t start  = HAL::micros();
+#endif
+
+    if (AT24CXX_JOB_WRITE == job.op)
+        result = writeChunk(dest, job.vals, chunk);
+    else if (AT24CXX_JOB_READ == job.op)
+        result = readDevice(dest, job.vals, chunk);
+    else if (AT24CXX_JOB_COPY == job.op)
+        result = readDevice(source, buffer, chunk) && writeChunk(dest, buffer, chunk);
+    else
+        return false;
+
+#ifdef AT24CXX_TRACE
+    trace((AT24CXX_JOB_READ == job.op) ? EEPROM_TRACE_READ : EEPROM_TRACE_WRITE, dest, chunk, start, result);
+#endif
+
+    if (!result)
+        return false;
+
+    if (!job.reverse)
+    {
+        job.address += chunk;
+        job.source  += chunk;
+
+        if (job.vals)
+            job.vals += chunk;
+    }
+
+    job.len -= chunk;
+
+    return true;
+}
+
+// Private: Estimated blocking time of one step moving the given number of bytes
+uint32_t AT24CXX::stepUs(uint8_t op, uint16_t bytes) const
+{
+    // Nine clocks per byte plus start and stop; reads add the device address again after a repeated start
+    uint32_t write_bits = (1 + _addr_bytes + bytes) * 9 + 2;
+    uint32_t read_bits  = (2 + _addr_bytes + bytes) * 9 + 3;
+    uint32_t bits;
+    uint32_t us;
+
+    if (AT24CXX_JOB_WRITE == op)
+        bits = write_bits;
+    else if (AT24CXX_JOB_READ == op)
+        bits = read_bits;
+    else if (AT24CXX_JOB_COPY == op)
+        bits = write_bits + read_bits;
+    else
+        return 0;
+
+    us = (uint32_t)(((uint64_t)bits * 1000000 + _bus_hz - 1) / _bus_hz);
+
+#ifndef AT24CXX_DEFERRED_WRITE_CYCLE
+    if (AT24CXX_JOB_READ != op)
+        us += EEPROM_WRITE_CYCLE_TIME_MS * 1000;
+#endif
+
+    return us;
+}
+
+// Private: Start write cycle of a page chunk just sent; blocks for the cycle unless deferred
+void AT24CXX::beginWriteCycle(uint16_t address, const uint8_t* vals, uint8_t len)
+{
+#ifdef AT24CXX_DEFERRED_WRITE_CYCLE
+    memcpy(_inflight, vals, len);
+    _inflight_address = address;
+    _inflight_len     = len;
+    _inflight_since   = HAL::millis();
+#else
+    (void)address;
+    (void)vals;
+    (void)len;
+    HAL::delay_ms(EEPROM_WRITE_CYCLE_TIME_MS);
+#endif
+}
+
 }
 
 // EOF
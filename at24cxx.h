@@ -14,6 +14,21 @@
 //               Use of write protect pin WP is optional, and calls to methods setWriteProtect() and
 //               clearWriteProtect() will only execute properly if wp_pin was included at call to init().
 //
+//               By default each page write blocks for the device's write cycle time. When AT24CXX_DEFERRED_WRITE_CYCLE
+//               is defined for the build, the write cycle of the last page written is instead left running on
+//               return, and the page is held in RAM until it completes: reads contained in that page are served
+//               from RAM immediately, while any other transfer first waits out the remainder of the cycle rather
+//               than polling a device which NACKs. This option requires HAL::millis().
+//
+//               Long writes, reads and copies may also be sliced for hard real-time callers. A begin call fills a
+//               caller-owned AT24CXXJob, and each resume() performs at most the given number of steps, each moving
+//               one page-bounded chunk, then returns with the job as its own continuation. resumeFor() instead
+//               spends a budget of microseconds, estimated from chip geometry and the bus clock set by
+//               setBusHz(), so the blocking time of every call is bounded by maxBlockingUs(). With
+//               AT24CXX_DEFERRED_WRITE_CYCLE a resume never waits out a write cycle: it returns without progress
+//               while the device is busy, so the bound is pure bus time. Without it, a write step includes the
+//               blocking write cycle delay.
+//
 // Language    : C++
 // Platform    : Portable
 // Framework   : Portable
@@ -26,9 +41,42 @@
 
 #include "hal.h"
 
+#ifdef AT24CXX_TRACE
+#include "at24cxx_trace.h"
+#endif
+
+// Largest page size across the AT24CXX family (AT24C512); sizes page buffers in layered modules
+#define AT24CXX_MAX_PAGE_SIZE 128
+
+// Largest data payload the HAL can send in one I2C write (e.g. 32-byte Wire buffer less 2 address bytes);
+// a HAL without such a limit may define a larger value so that whole pages are written per cycle
+#ifndef AT24CXX_I2C_WRITE_MAX
+#define AT24CXX_I2C_WRITE_MAX 30
+#endif
+
 namespace PeripheralIO
 {
 
+// Sliced Operation Types
+const uint8_t AT24CXX_JOB_NONE  = 0;
+const uint8_t AT24CXX_JOB_WRITE = 1;
+const uint8_t AT24CXX_JOB_READ  = 2;
+const uint8_t AT24CXX_JOB_COPY  = 3;
+
+// Continuation of a sliced operation; caller-owned and filled by a begin call
+struct AT24CXXJob
+{
+    uint8_t * vals;     // remaining caller data, write and read jobs only
+    uint16_t  address;  // destination of the remaining bytes
+    uint16_t  source;   // source of the remaining bytes, copy jobs only
+    uint16_t  len;      // bytes remaining
+    uint8_t   page;     // write chunk boundary, after sub-page splitting
+    uint8_t   op;       // AT24CXX_JOB_*
+    bool      reverse;  // copy proceeds from the end, for overlapping moves to higher addresses
+
+    bool done() const { return 0 == len; }
+};
+
 // Chip Selection Options
 extern const uint32_t AT24C01;
 extern const uint32_t AT24C02;
@@ -119,9 +167,109 @@ class AT24CXX
         */
         void clearWriteProtect() const;
 
+        /**
+         * @brief Get total memory size of the selected chip
+         * @return Chip size in bytes
+        */
+        uint32_t size() const { return _chip_size; }
+
+        /**
+         * @brief Get internal page size of the selected chip
+         * @return Page size in bytes
+        */
+        uint8_t pageSize() const { return _page_size; }
+
+        /**
+         * @brief Check whether a deferred write cycle is still in progress
+         * @return True while the device is programming, always false without AT24CXX_DEFERRED_WRITE_CYCLE
+        */
+        bool busy();
+
+        /**
+         * @brief Wait for any deferred write cycle to complete, e.g. before power-down or handing over the bus
+        */
+        void sync();
+
+        /**
+         * @brief Set I2C clock rate used to estimate transfer times for sliced operations
+         * @param hz Bus clock in Hz
+        */
+        void setBusHz(uint32_t hz) { _bus_hz = hz ? hz : 100000; }
+
+        /**
+         * @brief Prepare a sliced write; no transfer takes place until resume()
+         * @param job Continuation to fill
+         * @param address Starting address to which values should be written
+         * @param vals Pointer to values, which must remain valid until the job is done
+         * @param len Number of bytes to write
+         * @return False for invalid request, true otherwise
+        */
+        bool beginWrite(AT24CXXJob& job, uint16_t address, uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Prepare a sliced read; no transfer takes place until resume()
+         * @param job Continuation to fill
+         * @param address Starting address from which values should be read
+         * @param vals Pointer to array into which read values will be placed
+         * @param len Number of bytes to read
+         * @return False for invalid request, true otherwise
+        */
+        bool beginRead(AT24CXXJob& job, uint16_t address, uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Prepare a sliced copy within the device; overlapping ranges are handled
+         * @param job Continuation to fill
+         * @param dest Starting address of destination
+         * @param source Starting address of source
+         * @param len Number of bytes to copy
+         * @return False for invalid request, true otherwise
+        */
+        bool beginCopy(AT24CXXJob& job, uint16_t dest, uint16_t source, uint16_t len);
+
+        /**
+         * @brief Advance a sliced operation by at most a number of steps, each one page-bounded chunk
+         * @param job Continuation from a begin call
+         * @param max_steps Largest number of steps to perform
+         * @return False for I2C error, true otherwise; job.done() once complete
+        */
+        bool resume(AT24CXXJob& job, uint16_t max_steps);
+
+        /**
+         * @brief Advance a sliced operation by as many steps as fit in a time budget
+         * @param job Continuation from a begin call
+         * @param budget_us Estimated blocking time allowed; no progress is made below maxBlockingUs(op, 1)
+         * @return False for I2C error, true otherwise; job.done() once complete
+        */
+        bool resumeFor(AT24CXXJob& job, uint32_t budget_us);
+
+        /**
+         * @brief Get worst-case blocking time of a resume() call, excluding HAL software overhead
+         * @param op AT24CXX_JOB_* operation type
+         * @param steps Steps allowed per call
+         * @return Blocking time in microseconds
+        */
+        uint32_t maxBlockingUs(uint8_t op, uint16_t steps) const;
+
+#ifdef AT24CXX_TRACE
+        /**
+         * @brief Install hook receiving an event after every read or write call
+         * @param hook Function to call, or null to stop tracing
+         * @param context Pointer passed to hook, e.g. an EepromTraceBuffer
+        */
+        void setTraceHook(EepromTraceHook hook, void * context) { _trace_hook = hook; _trace_context = context; }
+#endif
+
     private:
         bool writeN(uint16_t, uint8_t*, uint16_t);
         bool readN(uint16_t, uint8_t*, uint16_t);
+        bool writeDevice(uint16_t, uint8_t*, uint16_t);
+        bool readDevice(uint16_t, uint8_t*, uint16_t);
+        bool writeChunk(uint16_t, uint8_t*, uint8_t);
+        void beginWriteCycle(uint16_t, const uint8_t*, uint8_t);
+        uint8_t writePageSize(uint16_t) const;
+        uint8_t nextChunk(const AT24CXXJob&) const;
+        bool step(AT24CXXJob&);
+        uint32_t stepUs(uint8_t, uint16_t) const;
 
         HAL::I2C& _i2c;
         HAL::GPIO _wp_pin;
@@ -132,6 +280,19 @@ class AT24CXX
         uint8_t   _addr_ov_bits;
         uint8_t   _addr_size;
         uint8_t   _mode;
+        uint32_t  _bus_hz;
+#ifdef AT24CXX_DEFERRED_WRITE_CYCLE
+        uint8_t   _inflight[AT24CXX_MAX_PAGE_SIZE];
+        uint32_t  _inflight_since;
+        uint16_t  _inflight_address;
+        uint8_t   _inflight_len;
+#endif
+#ifdef AT24CXX_TRACE
+        EepromTraceHook _trace_hook;
+        void *          _trace_context;
+
+        void trace(uint8_t op, uint16_t address, uint16_t len, uint32_t start, bool ok);
+#endif
 };
 
 }
@@ -0,0 +1,290 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_blob.cpp
+// Purpose     : AT24CXX EEPROM Content-Addressed Blob Store
+// Description : This source file implements header file at24cxx_blob.h.
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <string.h>
+#include "at24cxx_blob.h"
+#include "at24cxx_crc.h"
+
+namespace PeripheralIO
+{
+
+// Reference count at which an entry accepts no further references
+const uint16_t EEPROM_BLOB_MAX_REFS = 0xFFFF;
+
+// Private: FNV-1a 32-bit hash
+static uint32_t blobHash(const uint8_t * vals, uint16_t len)
+{
+    uint32_t h = 0x811C9DC5UL;
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        h ^= vals[i];
+        h *= 0x01000193UL;
+    }
+
+    return h;
+}
+
+
+EepromBlobStore::EepromBlobStore(AT24CXX& eeprom, uint16_t base, uint16_t length)
+: _eeprom(eeprom)
+, _base(base)
+, _page_size(eeprom.pageSize())
+, _table_pages(0)
+, _data_pages(0)
+{
+    uint16_t pages = length / _page_size;
+
+    _table_pages = (uint16_t)((sizeof(_table) + _page_size - 1) / _page_size);
+
+    if (pages > _table_pages)
+        _data_pages = pages - _table_pages;
+
+    memset(_table, 0, sizeof(_table));
+}
+
+bool EepromBlobStore::format()
+{
+    if (0 == _data_pages)
+        return false;
+
+    // Zeroed entries fail their CRC and so read back as free
+    memset(_table, 0, sizeof(_table));
+
+    return _eeprom.write(_base, (uint8_t*)_table, sizeof(_table));
+}
+
+bool EepromBlobStore::mount()
+{
+    if ((0 == _data_pages) || !_eeprom.read(_base, (uint8_t*)_table, sizeof(_table)))
+        return false;
+
+    for (uint8_t i = 0; i < AT24CXX_BLOB_MAX_ENTRIES; i++)
+    {
+        Entry& e = _table[i];
+
+        if ((entryCrc(e) != e.crc) || (0 == e.refs) || (0 == e.len)
+            || ((uint32_t)(e.first_page + pagesFor(e.len)) > _data_pages))
+            memset(&e, 0, sizeof(e));
+    }
+
+    return true;
+}
+
+bool EepromBlobStore::put(const uint8_t * vals, uint16_t len, EepromBlobHandle& handle)
+{
+    uint32_t hash = blobHash(vals, len);
+    int16_t  slot = -1;
+    uint16_t first;
+
+    handle = 0;
+
+    if (0 == len)
+        return false;
+
+    for (uint8_t i = 0; i < AT24CXX_BLOB_MAX_ENTRIES; i++)
+    {
+        Entry& e = _table[i];
+
+        if (e.refs && (e.refs < EEPROM_BLOB_MAX_REFS) && (e.hash == hash) && (e.len == len) && matches(e, vals))
+        {
+            // Duplicate costs one entry write instead of its pages
+            e.refs++;
+
+            if (!writeEntry(i))
+            {
+                e.refs--;
+                return false;
+            }
+
+            handle = (EepromBlobHandle)(i + 1);
+            return true;
+        }
+
+        if ((slot < 0) && !e.refs)
+            slot = i;
+    }
+
+    if ((slot < 0) || !allocate(pagesFor(len), first))
+        return false;
+
+    if (!_eeprom.write(pageAddress(first), (uint8_t*)vals, len))
+        return false;
+
+    _table[slot].hash       = hash;
+    _table[slot].first_page = first;
+    _table[slot].len        = len;
+    _table[slot].refs       = 1;
+    _table[slot].reserved   = 0;
+    _table[slot].pad        = 0;
+
+    if (!writeEntry((uint8_t)slot))
+    {
+        memset(&_table[slot], 0, sizeof(Entry));
+        return false;
+    }
+
+    handle = (EepromBlobHandle)(slot + 1);
+    return true;
+}
+
+bool EepromBlobStore::read(EepromBlobHandle handle, uint16_t offset, uint8_t * vals, uint16_t len)
+{
+    const Entry* e;
+
+    if (!valid(handle))
+        return false;
+
+    e = &_table[handle - 1];
+
+    if ((uint32_t)(offset + len) > e->len)
+        return false;
+
+    return _eeprom.read((uint16_t)(pageAddress(e->first_page) + offset), vals, len);
+}
+
+uint16_t EepromBlobStore::size(EepromBlobHandle handle) const
+{
+    return valid(handle) ? _table[handle - 1].len : 0;
+}
+
+bool EepromBlobStore::retain(EepromBlobHandle handle)
+{
+    if (!valid(handle) || (EEPROM_BLOB_MAX_REFS == _table[handle - 1].refs))
+        return false;
+
+    _table[handle - 1].refs++;
+
+    if (!writeEntry(handle - 1))
+    {
+        _table[handle - 1].refs--;
+        return false;
+    }
+
+    return true;
+}
+
+bool EepromBlobStore::release(EepromBlobHandle handle)
+{
+    Entry saved;
+
+    if (!valid(handle))
+        return false;
+
+    saved = _table[handle - 1];
+
+    if (0 == --_table[handle - 1].refs)
+        memset(&_table[handle - 1], 0, sizeof(Entry));
+
+    if (!writeEntry(handle - 1))
+    {
+        _table[handle - 1] = saved;
+        return false;
+    }
+
+    return true;
+}
+
+uint16_t EepromBlobStore::freePages() const
+{
+    uint16_t used = 0;
+
+    for (uint8_t i = 0; i < AT24CXX_BLOB_MAX_ENTRIES; i++)
+    {
+        if (_table[i].refs)
+            used += pagesFor(_table[i].len);
+    }
+
+    return (uint16_t)(_data_pages - used);
+}
+
+bool EepromBlobStore::valid(EepromBlobHandle handle) const
+{
+    return (handle > 0) && (handle <= AT24CXX_BLOB_MAX_ENTRIES) && (0 != _table[handle - 1].refs);
+}
+
+// Private: Compare stored blob contents against candidate, guarding against hash collisions
+bool EepromBlobStore::matches(const Entry& entry, const uint8_t * vals)
+{
+    uint8_t  chunk[16];
+    uint16_t addr = pageAddress(entry.first_page);
+    uint16_t n;
+
+    for (uint16_t pos = 0; pos < entry.len; pos += n)
+    {
+        n = ((uint16_t)(entry.len - pos) < sizeof(chunk)) ? (uint16_t)(entry.len - pos) : (uint16_t)sizeof(chunk);
+
+        if (!_eeprom.read((uint16_t)(addr + pos), chunk, n) || (0 != memcmp(chunk, &vals[pos], n)))
+            return false;
+    }
+
+    return true;
+}
+
+// Private: First-fit search for a run of free data pages
+bool EepromBlobStore::allocate(uint16_t pages, uint16_t& first) const
+{
+    uint16_t candidate = 0;
+    bool     moved     = true;
+
+    while (moved)
+    {
+        moved = false;
+
+        if ((uint32_t)(candidate + pages) > _data_pages)
+            return false;
+
+        for (uint8_t i = 0; i < AT24CXX_BLOB_MAX_ENTRIES; i++)
+        {
+            const Entry& e   = _table[i];
+            uint16_t     end = e.first_page + pagesFor(e.len);
+
+            if (e.refs && (candidate < end) && (e.first_page < candidate + pages))
+            {
+                candidate = end;
+                moved     = true;
+            }
+        }
+    }
+
+    first = candidate;
+    return true;
+}
+
+// Private: Persist single table entry
+bool EepromBlobStore::writeEntry(uint8_t index)
+{
+    _table[index].crc = entryCrc(_table[index]);
+
+    // A freed entry is written zeroed so that its stale CRC can never validate
+    if (0 == _table[index].refs)
+        _table[index].crc = 0;
+
+    return _eeprom.write((uint16_t)(_base + index * sizeof(Entry)), (uint8_t*)&_table[index], sizeof(Entry));
+}
+
+uint16_t EepromBlobStore::entryCrc(const Entry& entry) const
+{
+    return crc16((const uint8_t*)&entry, 10);
+}
+
+uint16_t EepromBlobStore::pageAddress(uint16_t page) const
+{
+    return (uint16_t)(_base + (_table_pages + page) * _page_size);
+}
+
+uint16_t EepromBlobStore::pagesFor(uint16_t len) const
+{
+    return (uint16_t)((len + _page_size - 1) / _page_size);
+}
+
+}
+
+// EOF
@@ -0,0 +1,134 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_blob.h
+// Purpose     : AT24CXX EEPROM Content-Addressed Blob Store
+// Description :
+//               Deduplicating store for immutable blobs such as lookup curves and string tables. Each incoming
+//               blob is hashed (FNV-1a) and compared against the RAM-cached blob table; a blob whose hash and
+//               length match a stored blob is confirmed by comparing contents on the device, after which storing
+//               it again costs only a reference count update rather than rewriting its pages. Unique blobs are
+//               placed in page-aligned extents, and their table entry is written after their data so that a power
+//               loss never leaves an entry referring to incomplete contents.
+//
+//               Table entries occupy 16-byte slots, each validated by its own CRC, so that a reference update is
+//               a single small write which on parts with pages of 16 bytes or more never straddles a page.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_BLOB_H
+#define _AT24CXX_BLOB_H
+
+#include "at24cxx.h"
+
+#ifndef AT24CXX_BLOB_MAX_ENTRIES
+#define AT24CXX_BLOB_MAX_ENTRIES 16
+#endif
+
+namespace PeripheralIO
+{
+
+// Blob handle; zero denotes no blob
+typedef uint8_t EepromBlobHandle;
+
+class EepromBlobStore
+{
+    public:
+       /**
+        * @brief Constructor for EepromBlobStore object
+        * @param eeprom Reference to initialized AT24CXX object
+        * @param base Page-aligned starting address of the region managed by the store
+        * @param length Length of the region in bytes
+       */
+        EepromBlobStore(AT24CXX& eeprom, uint16_t base, uint16_t length);
+
+        /**
+         * @brief Erase the blob table, discarding all blobs
+         * @return False for I2C error or region too small, true otherwise
+        */
+        bool format();
+
+        /**
+         * @brief Load blob table into RAM; must be called prior to use of member functions
+         * @return False for I2C error or region too small, true otherwise
+        */
+        bool mount();
+
+        /**
+         * @brief Store blob, or add a reference to an identical stored blob; a blob whose reference count is
+         *        exhausted is stored again as a separate copy
+         * @param vals Pointer to blob contents
+         * @param len Length of blob in bytes
+         * @param handle Out: handle of stored blob
+         * @return False if table or space is exhausted or I2C error, true otherwise
+        */
+        bool put(const uint8_t * vals, uint16_t len, EepromBlobHandle& handle);
+
+        /**
+         * @brief Read blob contents
+         * @param handle Handle of blob
+         * @param offset Offset within blob from which to read
+         * @param vals Pointer to array into which contents will be placed
+         * @param len Number of bytes to read
+         * @return False for invalid handle, out of range request, or I2C error; true otherwise
+        */
+        bool read(EepromBlobHandle handle, uint16_t offset, uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Get length of blob in bytes, zero for invalid handle
+        */
+        uint16_t size(EepromBlobHandle handle) const;
+
+        /**
+         * @brief Add a reference to a stored blob
+         * @return False for invalid handle, reference count exhausted or I2C error; true otherwise
+        */
+        bool retain(EepromBlobHandle handle);
+
+        /**
+         * @brief Drop a reference to a stored blob, freeing its pages with the last reference
+         * @return False for invalid handle or I2C error, true otherwise
+        */
+        bool release(EepromBlobHandle handle);
+
+        /**
+         * @brief Get the number of unallocated data pages in the region
+        */
+        uint16_t freePages() const;
+
+    private:
+        struct Entry
+        {
+            uint32_t hash;
+            uint16_t first_page;
+            uint16_t len;
+            uint16_t refs;
+            uint16_t reserved;
+            uint16_t crc;
+            uint16_t pad;
+        };
+
+        bool     valid(EepromBlobHandle handle) const;
+        bool     matches(const Entry& entry, const uint8_t * vals);
+        bool     allocate(uint16_t pages, uint16_t& first) const;
+        bool     writeEntry(uint8_t index);
+        uint16_t entryCrc(const Entry& entry) const;
+        uint16_t pageAddress(uint16_t page) const;
+        uint16_t pagesFor(uint16_t len) const;
+
+        AT24CXX& _eeprom;
+        Entry    _table[AT24CXX_BLOB_MAX_ENTRIES];
+        uint16_t _base;
+        uint16_t _page_size;
+        uint16_t _table_pages;
+        uint16_t _data_pages;
+};
+
+}
+
+#endif // _AT24CXX_BLOB_H
+
+// EOF
@@ -0,0 +1,235 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_cache.cpp
+// Purpose     : AT24CXX EEPROM Multi-Core Page Cache
+// Description : This source file implements header file at24cxx_cache.h.
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <string.h>
+#include "at24cxx_cache.h"
+
+#ifdef AT24CXX_SHARED_CACHE
+
+namespace PeripheralIO
+{
+
+const uint16_t CACHE_NO_PAGE = 0xFFFF;
+
+EepromPageCache::EepromPageCache(AT24CXX& eeprom)
+: _eeprom(eeprom)
+, _page_size(eeprom.pageSize())
+, _fills(0)
+{
+    for (uint8_t i = 0; i < AT24CXX_CACHE_LINES; i++)
+    {
+        _lines[i].seq.store(0, std::memory_order_relaxed);
+        _lines[i].page.store(CACHE_NO_PAGE, std::memory_order_relaxed);
+        _lines[i].filled = 0;
+    }
+
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+bool EepromPageCache::tryRead(uint16_t address, uint8_t * vals, uint16_t len) const
+{
+    uint16_t done = 0;
+
+    if ((uint32_t)(address + len) > _eeprom.size())
+        return false;
+
+    while (done < len)
+    {
+        uint16_t page   = (uint16_t)((address + done) / _page_size);
+        uint16_t offset = (uint16_t)((address + done) % _page_size);
+        uint16_t chunk  = ((_page_size - offset) < (len - done)) ? (_page_size - offset) : (len - done);
+        bool     hit    = false;
+
+        for (uint8_t i = 0; (i < AT24CXX_CACHE_LINES) && !hit; i++)
+        {
+            const Line& line = _lines[i];
+
+            for (int attempt = 0; attempt < AT24CXX_CACHE_ATTEMPTS; attempt++)
+            {
+                uint32_t seq = line.seq.load(std::memory_order_acquire);
+
+                if (seq & 1)
+                    continue;
+
+                if (line.page.load(std::memory_order_relaxed) != page)
+                    break;
+
+                memcpy(&vals[done], &line.data[offset], chunk);
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (line.seq.load(std::memory_order_relaxed) == seq)
+                {
+                    hit = true;
+                    break;
+                }
+            }
+        }
+
+        if (!hit)
+            return false;
+
+        done += chunk;
+    }
+
+    return true;
+}
+
+bool EepromPageCache::read(uint16_t address, uint8_t * vals, uint16_t len)
+{
+    uint16_t done = 0;
+
+    if ((uint32_t)(address + len) > _eeprom.size())
+        return false;
+
+    while (done < len)
+    {
+        uint16_t page   = (uint16_t)((address + done) / _page_size);
+        uint16_t offset = (uint16_t)((address + done) % _page_size);
+        uint16_t chunk  = ((_page_size - offset) < (len - done)) ? (_page_size - offset) : (len - done);
+        int      line   = load(page);
+
+        if (line < 0)
+            return false;
+
+        // Only the writer changes lines, so its own reads need no sequence check
+        memcpy(&vals[done], &_lines[line].data[offset], chunk);
+        done += chunk;
+    }
+
+    return true;
+}
+
+bool EepromPageCache::write(uint16_t address, const uint8_t * vals, uint16_t len)
+{
+    uint16_t done = 0;
+    bool     ok;
+
+    if ((uint32_t)(address + len) > _eeprom.size())
+        return false;
+
+    while (done < len)
+    {
+        uint16_t page   = (uint16_t)((address + done) / _page_size);
+        uint16_t offset = (uint16_t)((address + done) % _page_size);
+        uint16_t chunk  = ((_page_size - offset) < (len - done)) ? (_page_size - offset) : (len - done);
+        int      line   = lookup(page);
+
+        ok = _eeprom.write((uint16_t)(address + done), (uint8_t*)&vals[done], chunk);
+
+        if (line >= 0)
+        {
+            begin(_lines[line]);
+
+            if (ok)
+                memcpy(&_lines[line].data[offset], &vals[done], chunk);
+            else
+                _lines[line].page.store(CACHE_NO_PAGE, std::memory_order_relaxed);
+
+            end(_lines[line]);
+        }
+
+        if (!ok)
+            return false;
+
+        done += chunk;
+    }
+
+    return true;
+}
+
+bool EepromPageCache::fill(uint16_t address, uint16_t len)
+{
+    if (!len || ((uint32_t)(address + len) > _eeprom.size()))
+        return false;
+
+    for (uint32_t page = address / _page_size; page <= (uint32_t)(address + len - 1) / _page_size; page++)
+    {
+        if (load((uint16_t)page) < 0)
+            return false;
+    }
+
+    return true;
+}
+
+void EepromPageCache::invalidate(uint16_t address, uint16_t len)
+{
+    if (!len)
+        return;
+
+    for (uint32_t page = address / _page_size; page <= (uint32_t)(address + len - 1) / _page_size; page++)
+    {
+        int line = lookup((uint16_t)page);
+
+        if (line >= 0)
+        {
+            begin(_lines[line]);
+            _lines[line].page.store(CACHE_NO_PAGE, std::memory_order_relaxed);
+            end(_lines[line]);
+        }
+    }
+}
+
+// Private: Line holding a page, or -1
+int EepromPageCache::lookup(uint16_t page) const
+{
+    for (uint8_t i = 0; i < AT24CXX_CACHE_LINES; i++)
+    {
+        if (_lines[i].page.load(std::memory_order_relaxed) == page)
+            return i;
+    }
+
+    return -1;
+}
+
+// Private: Line holding a page, filling the oldest line from the device on a miss; -1 for I2C error
+int EepromPageCache::load(uint16_t page)
+{
+    int  line = lookup(page);
+    bool ok;
+
+    if (line >= 0)
+        return line;
+
+    line = 0;
+
+    for (uint8_t i = 1; i < AT24CXX_CACHE_LINES; i++)
+    {
+        if (_lines[i].filled < _lines[line].filled)
+            line = i;
+    }
+
+    // Readers see the line as changing for the whole bus read, so none can copy a half-filled page
+    begin(_lines[line]);
+    ok = _eeprom.read((uint16_t)(page * _page_size), _lines[line].data, _page_size);
+    _lines[line].page.store(ok ? page : CACHE_NO_PAGE, std::memory_order_relaxed);
+    _lines[line].filled = ++_fills;
+    end(_lines[line]);
+
+    return ok ? line : -1;
+}
+
+// Private: Open a line for change, turning its sequence odd
+void EepromPageCache::begin(Line& line)
+{
+    line.seq.store(line.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+// Private: Publish a changed line, turning its sequence even
+void EepromPageCache::end(Line& line)
+{
+    line.seq.store(line.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+}
+
+#endif // AT24CXX_SHARED_CACHE
+
+// EOF
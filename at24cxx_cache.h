@@ -0,0 +1,131 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_cache.h
+// Purpose     : AT24CXX EEPROM Multi-Core Page Cache
+// Description :
+//               Page cache whose contents may be read from any core without a lock and without touching the bus,
+//               while a single writer core owns the device. Each cache line holds one page and is guarded by a
+//               sequence lock. The writer makes the sequence odd while it changes a line and even again when done.
+//               tryRead() copies a line optimistically and accepts the copy only if the sequence was even and
+//               unchanged throughout. Otherwise it retries a few times, and then reports a miss rather than wait.
+//
+//               Only the writer core calls the other methods. read() serves hits and fills missing pages from the
+//               device, evicting the least recently filled line. fill() preloads hot pages, e.g. parameters read by
+//               the other core. write() writes through to the device and then patches any cached copy. A failed
+//               write, or invalidate(), drops the affected lines. Writes that bypass the cache must be followed
+//               by invalidate() for the same range.
+//
+//               tryRead() returning false is not an error: the caller should fall back to asking the writer core,
+//               e.g. through EepromOffload. The module requires <atomic>, so it is compiled only when
+//               AT24CXX_SHARED_CACHE is defined for the whole build. The host tools have a cross-process
+//               counterpart in host/shared_page_cache.h.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : <atomic>
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_CACHE_H
+#define _AT24CXX_CACHE_H
+
+#ifdef AT24CXX_SHARED_CACHE
+
+#include <atomic>
+#include "at24cxx.h"
+
+// Number of cached pages; each holds AT24CXX_MAX_PAGE_SIZE bytes
+#ifndef AT24CXX_CACHE_LINES
+#define AT24CXX_CACHE_LINES 4
+#endif
+
+// Optimistic copies attempted by tryRead() before reporting a miss
+#ifndef AT24CXX_CACHE_ATTEMPTS
+#define AT24CXX_CACHE_ATTEMPTS 4
+#endif
+
+namespace PeripheralIO
+{
+
+class EepromPageCache
+{
+    public:
+       /**
+        * @brief Constructor for EepromPageCache object
+        * @param eeprom Reference to initialized AT24CXX object, used by the writer core only
+       */
+        explicit EepromPageCache(AT24CXX& eeprom);
+
+        EepromPageCache(const EepromPageCache&) = delete;
+        EepromPageCache& operator=(const EepromPageCache&) = delete;
+
+        /**
+         * @brief Read from cached pages without locking or bus access; any core
+         * @param address Address from which values should be read
+         * @param vals Pointer to array into which read values will be placed
+         * @param len Number of bytes to read
+         * @return True if every byte was served from the cache; false on a miss or persistent contention, in
+         *         which case vals may be partly filled
+        */
+        bool tryRead(uint16_t address, uint8_t * vals, uint16_t len) const;
+
+        /**
+         * @brief Read through the cache, filling missing pages from the device; writer core only
+         * @param address Address from which values should be read
+         * @param vals Pointer to array into which read values will be placed
+         * @param len Number of bytes to read
+         * @return False for I2C error or invalid request, true otherwise
+        */
+        bool read(uint16_t address, uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Write through to the device and update cached copies; writer core only
+         * @param address Starting address to which values should be written
+         * @param vals Pointer to values to write
+         * @param len Number of bytes to write
+         * @return False for I2C error or invalid request, true otherwise
+        */
+        bool write(uint16_t address, const uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Load the pages covering a range into the cache; writer core only
+         * @param address Starting address of the range
+         * @param len Number of bytes in the range
+         * @return False for I2C error or invalid request, true otherwise
+        */
+        bool fill(uint16_t address, uint16_t len);
+
+        /**
+         * @brief Drop cached pages covering a range; writer core only
+         * @param address Starting address of the range
+         * @param len Number of bytes in the range
+        */
+        void invalidate(uint16_t address, uint16_t len);
+
+    private:
+        struct Line
+        {
+            std::atomic<uint32_t> seq;    // odd while the writer changes the line
+            std::atomic<uint16_t> page;   // cached page, or CACHE_NO_PAGE
+            uint32_t              filled; // writer-only fill order for eviction
+            uint8_t               data[AT24CXX_MAX_PAGE_SIZE];
+        };
+
+        int  lookup(uint16_t page) const;
+        int  load(uint16_t page);
+        void begin(Line& line);
+        void end(Line& line);
+
+        AT24CXX& _eeprom;
+        uint16_t _page_size;
+        uint32_t _fills;
+        Line     _lines[AT24CXX_CACHE_LINES];
+};
+
+}
+
+#endif // AT24CXX_SHARED_CACHE
+
+#endif // _AT24CXX_CACHE_H
+
+// EOF
@@ -0,0 +1,73 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_crc.cpp
+// Purpose     : AT24CXX EEPROM Integrity Helpers
+// Description : This source file implements header file at24cxx_crc.h.
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include "at24cxx_crc.h"
+
+namespace PeripheralIO
+{
+
+uint16_t crc16Update(uint16_t crc, const uint8_t * data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        crc ^= (uint16_t)(data[i] << 8);
+
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+uint16_t crc16(const uint8_t * data, uint16_t len)
+{
+    return crc16Update(AT24CXX_CRC16_INIT, data, len);
+}
+
+bool crc16Correct(uint8_t * data, uint16_t len, uint16_t& crc, bool& corrected)
+{
+    uint16_t syndrome = (uint16_t)(crc16(data, len) ^ crc);
+    uint16_t pattern  = 0x1021; // syndrome of the last data bit: x^16 mod G
+    uint32_t bits     = (uint32_t)len * 8;
+
+    corrected = false;
+
+    if (0 == syndrome)
+        return true;
+
+    // A single bit of the stored CRC itself
+    if (0 == (syndrome & (syndrome - 1)))
+    {
+        crc       = (uint16_t)(crc ^ syndrome);
+        corrected = true;
+        return true;
+    }
+
+    // Walk the syndrome of each data bit back from the end, multiplying by x modulo G
+    for (uint32_t k = 0; k < bits; k++)
+    {
+        if (pattern == syndrome)
+        {
+            data[len - 1 - (k / 8)] ^= (uint8_t)(1 << (k % 8));
+            corrected = true;
+            return true;
+        }
+
+        pattern = (pattern & 0x8000) ? (uint16_t)((pattern << 1) ^ 0x1021) : (uint16_t)(pattern << 1);
+    }
+
+    return false;
+}
+
+}
+
+// EOF
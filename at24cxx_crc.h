@@ -0,0 +1,61 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_crc.h
+// Purpose     : AT24CXX EEPROM Integrity Helpers
+// Description : 
+//               CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) shared by the layered AT24CXX storage modules for
+//               validating directories, headers and records held in EEPROM. The incremental form permits a CRC to
+//               be accumulated across several page-sized reads without buffering the whole image in RAM.
+//
+//               Over blocks shorter than 4 KB the CRC detects all 1-, 2- and 3-bit errors, and each single-bit error
+//               yields a distinct syndrome, so crc16Correct() can also locate and repair it.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_CRC_H
+#define _AT24CXX_CRC_H
+
+#include "hal.h"
+
+namespace PeripheralIO
+{
+
+// Initial value for an incremental CRC-16 computation
+const uint16_t AT24CXX_CRC16_INIT = 0xFFFF;
+
+/**
+ * @brief Accumulate bytes into a running CRC-16/CCITT-FALSE
+ * @param crc Running CRC value; AT24CXX_CRC16_INIT for the first block
+ * @param data Pointer to bytes to accumulate
+ * @param len Number of bytes to accumulate
+ * @return Updated CRC value
+*/
+uint16_t crc16Update(uint16_t crc, const uint8_t * data, uint16_t len);
+
+/**
+ * @brief Compute CRC-16/CCITT-FALSE over a single block
+ * @param data Pointer to bytes to checksum
+ * @param len Number of bytes to checksum
+ * @return CRC value
+*/
+uint16_t crc16(const uint8_t * data, uint16_t len);
+
+/**
+ * @brief Verify block against its stored CRC-16, repairing a single flipped bit in either
+ * @param data Pointer to bytes to verify; corrected in place
+ * @param len Number of bytes, less than 4096
+ * @param crc Stored CRC value; corrected in place
+ * @param corrected Out: true if a bit was repaired
+ * @return False for uncorrectable error, true otherwise
+*/
+bool crc16Correct(uint8_t * data, uint16_t len, uint16_t& crc, bool& corrected);
+
+}
+
+#endif // _AT24CXX_CRC_H
+
+// EOF
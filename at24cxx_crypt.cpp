@@ -0,0 +1,346 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_crypt.cpp
+// Purpose     : AT24CXX EEPROM Encryption at Rest
+// Description : This source file implements header file at24cxx_crypt.h.
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <string.h>
+#include "at24cxx_crypt.h"
+
+#if defined(__AES__) && (defined(__x86_64__) || defined(__i386__))
+#include <wmmintrin.h>
+#define AT24CXX_CRYPT_AESNI
+#endif
+
+namespace PeripheralIO
+{
+
+// Encryption Defines
+const uint8_t EEPROM_CRYPT_GEN_BYTES = 4; // generation trailer at end of each page
+const uint8_t EEPROM_CRYPT_BATCH     = 4; // counter blocks encrypted per batch
+
+static const uint8_t AES_SBOX[256] =
+{
+    0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+    0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+    0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+    0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+    0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+    0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+    0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+    0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+    0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+    0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+    0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+    0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+    0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+    0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+    0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+    0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16
+};
+
+// Private: Multiply by x in GF(2^8)
+static uint8_t xtime(uint8_t b)
+{
+    return (uint8_t)((b << 1) ^ ((b & 0x80) ? 0x1B : 0x00));
+}
+
+#ifndef AT24CXX_CRYPT_AESNI
+// Private: Software AES-128 block encryption using S-box only
+static void encryptBlock(const uint8_t * round_keys, const uint8_t * in, uint8_t * out)
+{
+    uint8_t s[16];
+    uint8_t t[16];
+
+    for (uint8_t i = 0; i < 16; i++)
+        s[i] = in[i] ^ round_keys[i];
+
+    for (uint8_t round = 1; round <= 10; round++)
+    {
+        // SubBytes and ShiftRows; state is column-major
+        for (uint8_t c = 0; c < 4; c++)
+        {
+            for (uint8_t r = 0; r < 4; r++)
+                t[c * 4 + r] = AES_SBOX[s[((c + r) & 3) * 4 + r]];
+        }
+
+        if (round < 10)
+        {
+            // MixColumns
+            for (uint8_t c = 0; c < 4; c++)
+            {
+                uint8_t* col = &t[c * 4];
+                uint8_t  a0  = col[0];
+                uint8_t  all = col[0] ^ col[1] ^ col[2] ^ col[3];
+
+                col[0] ^= all ^ xtime(col[0] ^ col[1]);
+                col[1] ^= all ^ xtime(col[1] ^ col[2]);
+                col[2] ^= all ^ xtime(col[2] ^ col[3]);
+                col[3] ^= all ^ xtime(col[3] ^ a0);
+            }
+        }
+
+        for (uint8_t i = 0; i < 16; i++)
+            s[i] = t[i] ^ round_keys[round * 16 + i];
+    }
+
+    memcpy(out, s, 16);
+}
+#endif
+
+
+Aes128::Aes128(const uint8_t * key)
+{
+    uint8_t rcon = 0x01;
+    uint8_t temp[4];
+
+    memcpy(_round_keys, key, 16);
+
+    for (uint8_t i = 4; i < 44; i++)
+    {
+        memcpy(temp, &_round_keys[(i - 1) * 4], 4);
+
+        if (0 == (i % 4))
+        {
+            uint8_t first = temp[0];
+
+            temp[0] = AES_SBOX[temp[1]] ^ rcon;
+            temp[1] = AES_SBOX[temp[2]];
+            temp[2] = AES_SBOX[temp[3]];
+            temp[3] = AES_SBOX[first];
+            rcon    = xtime(rcon);
+        }
+
+        for (uint8_t j = 0; j < 4; j++)
+            _round_keys[i * 4 + j] = _round_keys[(i - 4) * 4 + j] ^ temp[j];
+    }
+}
+
+Aes128::~Aes128()
+{
+    volatile uint8_t* p = _round_keys;
+
+    for (uint8_t i = 0; i < sizeof(_round_keys); i++)
+        p[i] = 0;
+}
+
+void Aes128::encrypt(const uint8_t * in, uint8_t * out, uint8_t n) const
+{
+#ifdef AT24CXX_CRYPT_AESNI
+    __m128i keys[11];
+    uint8_t i = 0;
+
+    for (uint8_t r = 0; r < 11; r++)
+        keys[r] = _mm_loadu_si128((const __m128i*)&_round_keys[r * 16]);
+
+    // Four independent blocks keep the AES unit's pipeline full
+    for (; (i + 4) <= n; i += 4)
+    {
+        __m128i b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&in[(i + 0) * 16]), keys[0]);
+        __m128i b1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&in[(i + 1) * 16]), keys[0]);
+        __m128i b2 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&in[(i + 2) * 16]), keys[0]);
+        __m128i b3 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&in[(i + 3) * 16]), keys[0]);
+
+        for (uint8_t r = 1; r < 10; r++)
+        {
+            b0 = _mm_aesenc_si128(b0, keys[r]);
+            b1 = _mm_aesenc_si128(b1, keys[r]);
+            b2 = _mm_aesenc_si128(b2, keys[r]);
+            b3 = _mm_aesenc_si128(b3, keys[r]);
+        }
+
+        _mm_storeu_si128((__m128i*)&out[(i + 0) * 16], _mm_aesenclast_si128(b0, keys[10]));
+        _mm_storeu_si128((__m128i*)&out[(i + 1) * 16], _mm_aesenclast_si128(b1, keys[10]));
+        _mm_storeu_si128((__m128i*)&out[(i + 2) * 16], _mm_aesenclast_si128(b2, keys[10]));
+        _mm_storeu_si128((__m128i*)&out[(i + 3) * 16], _mm_aesenclast_si128(b3, keys[10]));
+    }
+
+    for (; i < n; i++)
+    {
+        __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&in[i * 16]), keys[0]);
+
+        for (uint8_t r = 1; r < 10; r++)
+            b = _mm_aesenc_si128(b, keys[r]);
+
+        _mm_storeu_si128((__m128i*)&out[i * 16], _mm_aesenclast_si128(b, keys[10]));
+    }
+#else
+    for (uint8_t i = 0; i < n; i++)
+        encryptBlock(_round_keys, &in[i * 16], &out[i * 16]);
+#endif
+}
+
+
+EepromCipher::EepromCipher(AT24CXX& eeprom, uint16_t base, uint16_t pages, const uint8_t * key, uint32_t region_id)
+: _eeprom(eeprom)
+, _aes(key)
+, _region_id(region_id)
+, _base(base)
+, _pages(pages)
+, _page_size(eeprom.pageSize())
+, _payload((uint16_t)(eeprom.pageSize() - EEPROM_CRYPT_GEN_BYTES))
+{ }
+
+bool EepromCipher::write(uint16_t address, const uint8_t * vals, uint16_t len)
+{
+    uint8_t  page[AT24CXX_MAX_PAGE_SIZE];
+    uint16_t done = 0;
+    uint16_t index;
+    uint16_t offset;
+    uint16_t chunk;
+    uint16_t page_addr;
+    uint32_t generation;
+
+    if ((uint32_t)(address + len) > size())
+        return false;
+
+    while (done < len)
+    {
+        index     = (uint16_t)((address + done) / _payload);
+        offset    = (uint16_t)((address + done) % _payload);
+        chunk     = ((_payload - offset) < (len - done)) ? (_payload - offset) : (len - done);
+        page_addr = (uint16_t)(_base + index * _page_size);
+
+        if (chunk == _payload)
+        {
+            // Whole payload replaced; only the generation is needed from the device
+            if (!readGeneration(index, generation))
+                return false;
+        }
+        else
+        {
+            if (!_eeprom.read(page_addr, page, _page_size))
+                return false;
+
+            memcpy(&generation, &page[_payload], EEPROM_CRYPT_GEN_BYTES);
+            crypt(index, generation, 0, page, _payload);
+        }
+
+        memcpy(&page[offset], &vals[done], chunk);
+
+        generation++;
+
+        // New generation is committed before any data encrypted under it, so an interrupted write leaves the
+        // device on that generation and the next write moves past it instead of reusing its keystream
+        if (!writeGeneration(index, generation))
+            return false;
+
+        crypt(index, generation, 0, page, _payload);
+
+        if (!_eeprom.write(page_addr, page, _payload))
+            return false;
+
+        done += chunk;
+    }
+
+    return true;
+}
+
+bool EepromCipher::read(uint16_t address, uint8_t * vals, uint16_t len)
+{
+    uint16_t done = 0;
+    uint16_t index;
+    uint16_t offset;
+    uint16_t chunk;
+    uint32_t generation;
+
+    if ((uint32_t)(address + len) > size())
+        return false;
+
+    while (done < len)
+    {
+        index  = (uint16_t)((address + done) / _payload);
+        offset = (uint16_t)((address + done) % _payload);
+        chunk  = ((_payload - offset) < (len - done)) ? (_payload - offset) : (len - done);
+
+        if (!readGeneration(index, generation))
+            return false;
+
+        // Ciphertext is decrypted in place in the caller's buffer
+        if (!_eeprom.read((uint16_t)(_base + index * _page_size + offset), &vals[done], chunk))
+            return false;
+
+        crypt(index, generation, offset, &vals[done], chunk);
+        done += chunk;
+    }
+
+    return true;
+}
+
+// Private: Read generation trailer of page
+bool EepromCipher::readGeneration(uint16_t page, uint32_t& generation)
+{
+    return _eeprom.read((uint16_t)(_base + page * _page_size + _payload), (uint8_t*)&generation,
+                        EEPROM_CRYPT_GEN_BYTES);
+}
+
+// Private: Write generation trailer of page and read it back
+bool EepromCipher::writeGeneration(uint16_t page, uint32_t generation)
+{
+    uint32_t check;
+
+    if (!_eeprom.write((uint16_t)(_base + page * _page_size + _payload), (uint8_t*)&generation,
+                       EEPROM_CRYPT_GEN_BYTES))
+        return false;
+
+    return readGeneration(page, check) && (check == generation);
+}
+
+// Private: XOR keystream for bytes [offset, offset + len) of page under generation
+void EepromCipher::crypt(uint16_t page, uint32_t generation, uint16_t offset, uint8_t * data, uint16_t len) const
+{
+    uint8_t  ctr[EEPROM_CRYPT_BATCH * 16];
+    uint8_t  n;
+    uint16_t block = offset / 16;
+    uint16_t last  = (uint16_t)((offset + len - 1) / 16);
+    uint16_t pos;
+
+    while (block <= last)
+    {
+        n = ((last - block + 1) < EEPROM_CRYPT_BATCH) ? (uint8_t)(last - block + 1) : EEPROM_CRYPT_BATCH;
+
+        // Counter block: region(4) | page(4) | generation(4) | block(4), big-endian
+        for (uint8_t b = 0; b < n; b++)
+        {
+            uint8_t* c   = &ctr[b * 16];
+            uint32_t blk = block + b;
+
+            c[0]  = (uint8_t)(_region_id >> 24);
+            c[1]  = (uint8_t)(_region_id >> 16);
+            c[2]  = (uint8_t)(_region_id >> 8);
+            c[3]  = (uint8_t)(_region_id);
+            c[4]  = 0;
+            c[5]  = 0;
+            c[6]  = (uint8_t)(page >> 8);
+            c[7]  = (uint8_t)(page);
+            c[8]  = (uint8_t)(generation >> 24);
+            c[9]  = (uint8_t)(generation >> 16);
+            c[10] = (uint8_t)(generation >> 8);
+            c[11] = (uint8_t)(generation);
+            c[12] = (uint8_t)(blk >> 24);
+            c[13] = (uint8_t)(blk >> 16);
+            c[14] = (uint8_t)(blk >> 8);
+            c[15] = (uint8_t)(blk);
+        }
+
+        _aes.encrypt(ctr, ctr, n);
+
+        for (uint16_t i = 0; i < (uint16_t)(n * 16); i++)
+        {
+            pos = (uint16_t)(block * 16 + i);
+
+            if ((pos >= offset) && (pos < offset + len))
+                data[pos - offset] ^= ctr[i];
+        }
+
+        block += n;
+    }
+}
+
+}
+
+// EOF
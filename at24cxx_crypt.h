@@ -0,0 +1,122 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_crypt.h
+// Purpose     : AT24CXX EEPROM Encryption at Rest
+// Description :
+//               AES-128-CTR encryption layer over a page-aligned AT24CXX region, keyed per region. The last four
+//               bytes of every page hold a write generation which is advanced each time the page is rewritten;
+//               the CTR counter block is formed from the region identifier, page index, page generation and block
+//               index. The region therefore presents pageSize() - 4 bytes of plaintext per page through its own
+//               linear address space.
+//
+//               A rewrite first writes the page's new generation and reads it back, and only then writes data
+//               encrypted under it. A write interrupted by a reset or I2C error, including one the driver split
+//               into sub-pages, thus leaves the device on the generation that was in use, and the next write
+//               advances past it; no keystream is reused for different plaintext at the same address. The cost
+//               is two write cycles per page rewritten.
+//
+//               Data is encrypted and decrypted page by page as it passes through the driver's page chunking:
+//               reads decrypt in place in the caller's buffer, and writes use a single page-sized buffer. A page
+//               only partially covered by a write is read, decrypted, patched and re-encrypted as a whole under
+//               its new generation.
+//
+//               An interrupted rewrite leaves a page whose data is part old and part new under the new
+//               generation; the old part reads back as garbage, without any error. Data that must survive a power
+//               loss needs its own integrity check or a journaling layer above the cipher.
+//
+//               Block encryption uses AES-NI on x86 hosts compiled with AES support (e.g. -maes), processing
+//               several counter blocks at once for bulk provisioning. Elsewhere a compact software AES with only
+//               the 256-byte S-box, and no T-tables, is used.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_CRYPT_H
+#define _AT24CXX_CRYPT_H
+
+#include "at24cxx.h"
+
+namespace PeripheralIO
+{
+
+class Aes128
+{
+    public:
+       /**
+        * @brief Constructor for Aes128 object; expands the key schedule
+        * @param key Pointer to 16-byte key
+       */
+        explicit Aes128(const uint8_t * key);
+
+        ~Aes128();
+
+        /**
+         * @brief Encrypt consecutive 16-byte blocks
+         * @param in Pointer to n * 16 bytes of input
+         * @param out Pointer to n * 16 bytes of output; may equal in
+         * @param n Number of blocks
+        */
+        void encrypt(const uint8_t * in, uint8_t * out, uint8_t n) const;
+
+    private:
+        uint8_t _round_keys[176];
+};
+
+class EepromCipher
+{
+    public:
+       /**
+        * @brief Constructor for EepromCipher object
+        * @param eeprom Reference to initialized AT24CXX object
+        * @param base Page-aligned starting address of the encrypted region
+        * @param pages Number of pages in the region
+        * @param key Pointer to 16-byte AES key for the region
+        * @param region_id Identifier distinguishing regions that share a key
+       */
+        EepromCipher(AT24CXX& eeprom, uint16_t base, uint16_t pages, const uint8_t * key, uint32_t region_id=0);
+
+        /**
+         * @brief Encrypt and write plaintext
+         * @param address Starting plaintext address within the region
+         * @param vals Pointer to plaintext
+         * @param len Number of bytes to write
+         * @return False for I2C error or invalid request, true otherwise
+        */
+        bool write(uint16_t address, const uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Read and decrypt plaintext
+         * @param address Starting plaintext address within the region
+         * @param vals Pointer to array into which plaintext will be placed
+         * @param len Number of bytes to read
+         * @return False for I2C error or invalid request, true otherwise
+        */
+        bool read(uint16_t address, uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Get plaintext capacity of the region in bytes
+        */
+        uint16_t size() const { return (uint16_t)(_pages * _payload); }
+
+    private:
+        bool readGeneration(uint16_t page, uint32_t& generation);
+        bool writeGeneration(uint16_t page, uint32_t generation);
+        void crypt(uint16_t page, uint32_t generation, uint16_t offset, uint8_t * data, uint16_t len) const;
+
+        AT24CXX& _eeprom;
+        Aes128   _aes;
+        uint32_t _region_id;
+        uint16_t _base;
+        uint16_t _pages;
+        uint16_t _page_size;
+        uint16_t _payload;
+};
+
+}
+
+#endif // _AT24CXX_CRYPT_H
+
+// EOF
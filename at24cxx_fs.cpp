@@ -0,0 +1,467 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_fs.cpp
+// Purpose     : AT24CXX EEPROM Flat File System
+// Description : This source file implements header file at24cxx_fs.h.
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <string.h>
+#include "at24cxx_fs.h"
+#include "at24cxx_crc.h"
+
+namespace PeripheralIO
+{
+
+// Directory Defines
+const uint16_t EEPROM_FS_MAGIC = 0x4653; // "FS"
+
+
+EepromFile::EepromFile()
+: _fs(0)
+, _slot(0)
+, _pos(0)
+, _size(0)
+, _buf_page(0)
+, _buf_valid(false)
+, _buf_dirty(false)
+{ }
+
+uint16_t EepromFile::read(uint8_t * vals, uint16_t len)
+{
+    uint16_t page_size;
+    uint16_t file_addr;
+    uint16_t buf_start;
+
+    if (!_fs || (_pos >= _size))
+        return 0;
+
+    if (len > (uint16_t)(_size - _pos))
+        len = _size - _pos;
+
+    page_size = _fs->_page_size;
+    file_addr = _fs->pageAddress(_fs->_dir.entries[_slot].first_page);
+    buf_start = _buf_page * page_size;
+
+    // Served entirely from the buffered page without bus access
+    if (_buf_valid && (_pos >= buf_start) && ((uint32_t)(_pos + len) <= (uint32_t)(buf_start + page_size)))
+    {
+        memcpy(vals, &_buf[_pos - buf_start], len);
+        _pos += len;
+        return len;
+    }
+
+    if (!_fs->_eeprom.read((uint16_t)(file_addr + _pos), vals, len))
+        return 0;
+
+    // Overlay pending bytes of the buffered page
+    if (_buf_dirty && (_pos < buf_start + page_size) && (_pos + len > buf_start))
+    {
+        uint16_t from = (_pos > buf_start) ? _pos : buf_start;
+        uint16_t to   = ((_pos + len) < (buf_start + page_size)) ? (_pos + len) : (buf_start + page_size);
+
+        memcpy(&vals[from - _pos], &_buf[from - buf_start], to - from);
+    }
+
+    _pos += len;
+    return len;
+}
+
+uint16_t EepromFile::write(const uint8_t * vals, uint16_t len)
+{
+    uint16_t written = 0;
+    uint16_t page_size;
+    uint16_t cap;
+    uint16_t page;
+    uint16_t offset;
+    uint16_t chunk;
+    uint16_t page_start;
+    uint16_t page_end;
+
+    if (!_fs)
+        return 0;
+
+    page_size = _fs->_page_size;
+    cap       = capacity();
+
+    while ((written < len) && (_pos < cap))
+    {
+        page       = _pos / page_size;
+        offset     = _pos % page_size;
+        page_start = page * page_size;
+        chunk      = page_size - offset;
+
+        if (chunk > (len - written))
+            chunk = len - written;
+
+        if (!_buf_valid || (_buf_page != page))
+        {
+            // Existing bytes must be preserved only where they lie outside this chunk but within the file
+            page_end = ((uint32_t)(page_start + page_size) < _size) ? (page_start + page_size) : _size;
+
+            if (!loadPage(page, (_pos > page_start) || ((uint16_t)(_pos + chunk) < page_end)))
+                break;
+        }
+
+        memcpy(&_buf[offset], &vals[written], chunk);
+        _buf_dirty = true;
+
+        written += chunk;
+        _pos    += chunk;
+
+        if (_pos > _size)
+            _size = _pos;
+    }
+
+    return written;
+}
+
+bool EepromFile::seek(uint16_t pos)
+{
+    if (!_fs || (pos > _size))
+        return false;
+
+    _pos = pos;
+    return true;
+}
+
+uint16_t EepromFile::capacity() const
+{
+    if (!_fs)
+        return 0;
+
+    return (uint16_t)(_fs->_dir.entries[_slot].pages * _fs->_page_size);
+}
+
+bool EepromFile::sync()
+{
+    if (!_fs || !flushPage())
+        return false;
+
+    if (_fs->_dir.entries[_slot].size != _size)
+    {
+        EepromFS::Directory next = _fs->_dir;
+
+        next.entries[_slot].size = _size;
+        return _fs->commit(next);
+    }
+
+    return true;
+}
+
+bool EepromFile::close()
+{
+    bool result = sync();
+
+    _fs        = 0;
+    _buf_valid = false;
+    _buf_dirty = false;
+
+    return result;
+}
+
+// Private: Replace buffered page, optionally filling it with current device contents
+bool EepromFile::loadPage(uint16_t page, bool fill)
+{
+    uint16_t page_size = _fs->_page_size;
+
+    if (!flushPage())
+        return false;
+
+    _buf_valid = false;
+
+    if (fill)
+    {
+        if (!_fs->_eeprom.read(_fs->pageAddress(_fs->_dir.entries[_slot].first_page + page), _buf, page_size))
+            return false;
+    }
+    else
+    {
+        memset(_buf, 0xFF, page_size);
+    }
+
+    _buf_page  = page;
+    _buf_valid = true;
+
+    return true;
+}
+
+// Private: Commit buffered page as one full-page chunk
+bool EepromFile::flushPage()
+{
+    if (!_buf_dirty)
+        return true;
+
+    if (!_fs->_eeprom.write(_fs->pageAddress(_fs->_dir.entries[_slot].first_page + _buf_page), _buf, _fs->_page_size))
+        return false;
+
+    _buf_dirty = false;
+    return true;
+}
+
+
+EepromFS::EepromFS(AT24CXX& eeprom, uint16_t base, uint32_t length)
+: _eeprom(eeprom)
+, _base(base)
+, _page_size(eeprom.pageSize())
+, _slot_pages(0)
+, _data_pages(0)
+, _mounted(false)
+{
+    uint32_t pages;
+
+    if (0 == length)
+        length = (eeprom.size() > base) ? (eeprom.size() - base) : 0;
+
+    pages       = length / _page_size;
+    _slot_pages = (uint16_t)((sizeof(Directory) + _page_size - 1) / _page_size);
+
+    if (pages > (uint32_t)(2 * _slot_pages))
+        _data_pages = (uint16_t)(pages - 2 * _slot_pages);
+
+    memset(&_dir, 0, sizeof(_dir));
+}
+
+bool EepromFS::format()
+{
+    Directory empty;
+
+    if (0 == _data_pages)
+        return false;
+
+    memset(&_dir, 0, sizeof(_dir));
+    memset(&empty, 0, sizeof(empty));
+    empty.magic = EEPROM_FS_MAGIC;
+
+    // Commit twice so that both slots hold a valid, empty directory
+    _mounted = commit(empty) && commit(empty);
+
+    return _mounted;
+}
+
+bool EepromFS::mount()
+{
+    Directory other;
+    bool      valid_a;
+    bool      valid_b;
+
+    _mounted = false;
+
+    if (0 == _data_pages)
+        return false;
+
+    valid_a = readSlot(0, _dir);
+    valid_b = readSlot(1, other);
+
+    if (valid_b && (!valid_a || ((int16_t)(other.generation - _dir.generation) > 0)))
+        memcpy(&_dir, &other, sizeof(_dir));
+    else if (!valid_a)
+        return false;
+
+    _mounted = true;
+    return true;
+}
+
+bool EepromFS::create(const char * name, uint16_t capacity)
+{
+    Directory next;
+    uint16_t  pages;
+    uint16_t  first;
+    int8_t    slot = -1;
+
+    if (!_mounted || !name[0] || (strlen(name) > AT24CXX_FS_NAME_LEN) || (find(name) >= 0))
+        return false;
+
+    for (uint8_t i = 0; i < AT24CXX_FS_MAX_FILES; i++)
+    {
+        if (!_dir.entries[i].name[0])
+        {
+            slot = i;
+            break;
+        }
+    }
+
+    pages = (uint16_t)((capacity + _page_size - 1) / _page_size);
+
+    if ((slot < 0) || (0 == pages) || !allocate(pages, first))
+        return false;
+
+    next = _dir;
+
+    memset(&next.entries[slot], 0, sizeof(Entry));
+    strncpy(next.entries[slot].name, name, AT24CXX_FS_NAME_LEN);
+    next.entries[slot].first_page = first;
+    next.entries[slot].pages      = pages;
+    next.count++;
+
+    return commit(next);
+}
+
+bool EepromFS::remove(const char * name)
+{
+    Directory next;
+    int8_t    slot = find(name);
+
+    if (slot < 0)
+        return false;
+
+    next = _dir;
+
+    memset(&next.entries[slot], 0, sizeof(Entry));
+    next.count--;
+
+    return commit(next);
+}
+
+bool EepromFS::rename(const char * from, const char * to)
+{
+    Directory next;
+    int8_t    slot = find(from);
+    int8_t    old  = find(to);
+
+    if ((slot < 0) || !to[0] || (strlen(to) > AT24CXX_FS_NAME_LEN))
+        return false;
+
+    if (old == slot)
+        return true;
+
+    next = _dir;
+
+    // Replaced file is dropped in the same directory generation as the rename
+    if (old >= 0)
+    {
+        memset(&next.entries[old], 0, sizeof(Entry));
+        next.count--;
+    }
+
+    memset(next.entries[slot].name, 0, AT24CXX_FS_NAME_LEN);
+    strncpy(next.entries[slot].name, to, AT24CXX_FS_NAME_LEN);
+
+    return commit(next);
+}
+
+bool EepromFS::exists(const char * name) const
+{
+    return (find(name) >= 0);
+}
+
+bool EepromFS::open(const char * name, EepromFile& file)
+{
+    int8_t slot = find(name);
+
+    if (slot < 0)
+        return false;
+
+    file._fs        = this;
+    file._slot      = (uint8_t)slot;
+    file._pos       = 0;
+    file._size      = _dir.entries[slot].size;
+    file._buf_valid = false;
+    file._buf_dirty = false;
+
+    return true;
+}
+
+uint16_t EepromFS::freePages() const
+{
+    uint16_t used = 0;
+
+    for (uint8_t i = 0; i < AT24CXX_FS_MAX_FILES; i++)
+    {
+        if (_dir.entries[i].name[0])
+            used += _dir.entries[i].pages;
+    }
+
+    return (uint16_t)(_data_pages - used);
+}
+
+// Private: Locate directory slot of named file, -1 if absent
+int8_t EepromFS::find(const char * name) const
+{
+    if (!_mounted)
+        return -1;
+
+    for (uint8_t i = 0; i < AT24CXX_FS_MAX_FILES; i++)
+    {
+        if (_dir.entries[i].name[0] && (0 == strncmp(_dir.entries[i].name, name, AT24CXX_FS_NAME_LEN))
+            && (strlen(name) <= AT24CXX_FS_NAME_LEN))
+            return (int8_t)i;
+    }
+
+    return -1;
+}
+
+// Private: First-fit search for a run of free data pages
+bool EepromFS::allocate(uint16_t pages, uint16_t& first) const
+{
+    uint16_t candidate = 0;
+    bool     moved     = true;
+
+    while (moved)
+    {
+        moved = false;
+
+        if ((uint32_t)(candidate + pages) > _data_pages)
+            return false;
+
+        for (uint8_t i = 0; i < AT24CXX_FS_MAX_FILES; i++)
+        {
+            const Entry& e = _dir.entries[i];
+
+            if (e.name[0] && (candidate < e.first_page + e.pages) && (e.first_page < candidate + pages))
+            {
+                candidate = e.first_page + e.pages;
+                moved     = true;
+            }
+        }
+    }
+
+    first = candidate;
+    return true;
+}
+
+// Private: Persist directory into the inactive slot under the next generation, adopting it once written
+bool EepromFS::commit(Directory& next)
+{
+    next.generation = _dir.generation + 1;
+    next.crc        = dirCrc(next);
+
+    // Cached directory and generation advance only once written, so a retry targets the same inactive slot
+    if (!_eeprom.write(slotAddress(next.generation & 1), (uint8_t*)&next, sizeof(next)))
+        return false;
+
+    memcpy(&_dir, &next, sizeof(_dir));
+    return true;
+}
+
+// Private: Read and validate one directory slot
+bool EepromFS::readSlot(uint8_t slot, Directory& dir)
+{
+    if (!_eeprom.read(slotAddress(slot), (uint8_t*)&dir, sizeof(dir)))
+        return false;
+
+    return (EEPROM_FS_MAGIC == dir.magic) && (dirCrc(dir) == dir.crc);
+}
+
+uint16_t EepromFS::slotAddress(uint8_t slot) const
+{
+    return (uint16_t)(_base + slot * _slot_pages * _page_size);
+}
+
+uint16_t EepromFS::pageAddress(uint16_t page) const
+{
+    return (uint16_t)(_base + (2 * _slot_pages + page) * _page_size);
+}
+
+uint16_t EepromFS::dirCrc(const Directory& dir) const
+{
+    uint16_t crc = crc16Update(AT24CXX_CRC16_INIT, (const uint8_t*)&dir, 6);
+
+    return crc16Update(crc, (const uint8_t*)dir.entries, sizeof(dir.entries));
+}
+
+}
+
+// EOF
@@ -0,0 +1,228 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_fs.h
+// Purpose     : AT24CXX EEPROM Flat File System
+// Description :
+//               Minimal flat file system for the larger AT24CXX parts. Each file is a named, contiguous,
+//               page-aligned extent whose capacity is fixed at creation, so files may be added later without
+//               relaying out existing data. The directory is cached in RAM and persisted in two alternating slots
+//               stamped with a generation counter; every directory change (create, remove, rename, size update) is
+//               committed by writing the inactive slot, so a power loss mid-commit leaves the previous directory
+//               intact. A rename over an existing file is therefore atomic. Changes are prepared in a copy of the
+//               directory and reach the RAM cache only once committed, so a failed change leaves no trace.
+//
+//               File contents are accessed through EepromFile stream handles. A handle buffers one page in RAM and
+//               always commits it to the device as a complete, page-aligned writeN() chunk, filling bytes that
+//               were not written with their current device contents.
+//
+//               The region managed must begin on a page boundary. Directory capacity and name length are fixed at
+//               compile time by AT24CXX_FS_MAX_FILES and AT24CXX_FS_NAME_LEN.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_FS_H
+#define _AT24CXX_FS_H
+
+#include "at24cxx.h"
+
+#ifndef AT24CXX_FS_MAX_FILES
+#define AT24CXX_FS_MAX_FILES 8
+#endif
+
+#ifndef AT24CXX_FS_NAME_LEN
+#define AT24CXX_FS_NAME_LEN 8
+#endif
+
+namespace PeripheralIO
+{
+
+class EepromFS;
+
+class EepromFile
+{
+    public:
+        EepromFile();
+
+        /**
+         * @brief Read from current file position, advancing the position
+         * @param vals Pointer to array into which read values will be placed
+         * @param len Maximum number of bytes to read
+         * @return Number of bytes read; zero at end of file or on I2C error
+        */
+        uint16_t read(uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Write at current file position, advancing the position and extending the file as needed
+         * @param vals Pointer to array of values to write
+         * @param len Number of bytes to write
+         * @return Number of bytes accepted; short when the file's extent is full or on I2C error
+        */
+        uint16_t write(const uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Set the current file position
+         * @param pos New position; may not exceed the current file size
+         * @return False for invalid position or closed handle, true otherwise
+        */
+        bool seek(uint16_t pos);
+
+        /**
+         * @brief Get the current file position
+        */
+        uint16_t tell() const { return _pos; }
+
+        /**
+         * @brief Get the current file size, including buffered writes
+        */
+        uint16_t size() const { return _size; }
+
+        /**
+         * @brief Get the maximum file size permitted by the file's extent
+        */
+        uint16_t capacity() const;
+
+        /**
+         * @brief Commit the buffered page and persist the file size in the directory
+         * @return False for I2C error or closed handle, true otherwise
+        */
+        bool sync();
+
+        /**
+         * @brief Synchronize and release the handle
+         * @return False for I2C error or closed handle, true otherwise
+        */
+        bool close();
+
+        /**
+         * @brief Check whether the handle refers to an open file
+        */
+        bool isOpen() const { return (0 != _fs); }
+
+    private:
+        friend class EepromFS;
+
+        bool loadPage(uint16_t page, bool fill);
+        bool flushPage();
+
+        EepromFS* _fs;
+        uint8_t   _slot;
+        uint16_t  _pos;
+        uint16_t  _size;
+        uint16_t  _buf_page;
+        bool      _buf_valid;
+        bool      _buf_dirty;
+        uint8_t   _buf[AT24CXX_MAX_PAGE_SIZE];
+};
+
+class EepromFS
+{
+    public:
+       /**
+        * @brief Constructor for EepromFS object
+        * @param eeprom Reference to initialized AT24CXX object
+        * @param base Page-aligned starting address of the region managed by the file system
+        * @param length Length of the region in bytes; value 0 for remainder of chip
+       */
+        EepromFS(AT24CXX& eeprom, uint16_t base=0, uint32_t length=0);
+
+        /**
+         * @brief Erase the directory, discarding all files
+         * @return False for I2C error or region too small, true otherwise
+        */
+        bool format();
+
+        /**
+         * @brief Load the most recent valid directory into RAM; must be called prior to use of member functions
+         * @return False if no valid directory is present (format() required), true otherwise
+        */
+        bool mount();
+
+        /**
+         * @brief Create an empty file reserving a page-aligned extent
+         * @param name Null-terminated file name of at most AT24CXX_FS_NAME_LEN characters
+         * @param capacity Maximum file size in bytes, rounded up to whole pages
+         * @return False if name exists, directory is full, space is exhausted, or I2C error; true otherwise
+        */
+        bool create(const char * name, uint16_t capacity);
+
+        /**
+         * @brief Remove a file and release its extent
+         * @param name Null-terminated file name
+         * @return False if file is absent or I2C error, true otherwise
+        */
+        bool remove(const char * name);
+
+        /**
+         * @brief Atomically rename a file, replacing any existing file of the new name
+         * @param from Null-terminated name of existing file
+         * @param to Null-terminated new file name
+         * @return False if file is absent, name is invalid, or I2C error; true otherwise
+        */
+        bool rename(const char * from, const char * to);
+
+        /**
+         * @brief Check whether a file exists
+         * @param name Null-terminated file name
+        */
+        bool exists(const char * name) const;
+
+        /**
+         * @brief Open an existing file for streaming access; the position starts at zero
+         * @param name Null-terminated file name
+         * @param file Handle to bind to the file
+         * @return False if file is absent or file system not mounted, true otherwise
+        */
+        bool open(const char * name, EepromFile& file);
+
+        /**
+         * @brief Get the number of unallocated data pages in the region
+        */
+        uint16_t freePages() const;
+
+    private:
+        friend class EepromFile;
+
+        struct Entry
+        {
+            char     name[AT24CXX_FS_NAME_LEN];
+            uint16_t first_page;
+            uint16_t pages;
+            uint16_t size;
+            uint16_t reserved;
+        };
+
+        struct Directory
+        {
+            uint16_t magic;
+            uint16_t generation;
+            uint16_t count;
+            uint16_t crc;
+            Entry    entries[AT24CXX_FS_MAX_FILES];
+        };
+
+        int8_t   find(const char * name) const;
+        bool     allocate(uint16_t pages, uint16_t& first) const;
+        bool     commit(Directory& next);
+        bool     readSlot(uint8_t slot, Directory& dir);
+        uint16_t slotAddress(uint8_t slot) const;
+        uint16_t pageAddress(uint16_t page) const;
+        uint16_t dirCrc(const Directory& dir) const;
+
+        AT24CXX&  _eeprom;
+        Directory _dir;
+        uint16_t  _base;
+        uint16_t  _page_size;
+        uint16_t  _slot_pages;
+        uint16_t  _data_pages;
+        bool      _mounted;
+};
+
+}
+
+#endif // _AT24CXX_FS_H
+
+// EOF
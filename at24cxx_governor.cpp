@@ -0,0 +1,275 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_governor.cpp
+// Purpose     : AT24CXX EEPROM Endurance Governor
+// Description : This source file implements header file at24cxx_governor.h.
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <string.h>
+#include "at24cxx_governor.h"
+
+namespace PeripheralIO
+{
+
+// Milliseconds per year of 365.25 days
+const uint64_t GOVERNOR_MS_PER_YEAR = 31557600000ull;
+
+EepromGovernor::EepromGovernor(AT24CXX& eeprom)
+: _eeprom(eeprom)
+, _count(0)
+, _last_ms(0)
+, _started(false)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+bool EepromGovernor::addRegion(uint16_t address, uint16_t len, uint8_t * shadow, uint32_t endurance,
+                               uint16_t years, uint16_t burst, EepromOverflow policy)
+{
+    uint64_t interval;
+
+    if ((_count >= AT24CXX_GOVERNOR_REGIONS) || !len || !shadow || !endurance || !years || !burst ||
+        ((uint32_t)address + len > _eeprom.size()))
+        return false;
+
+    // A page shared with ungoverned data would take write cycles outside the budget
+    if ((address % _eeprom.pageSize()) || (len % _eeprom.pageSize()))
+        return false;
+
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        if ((address < (uint32_t)_regions[i].address + _regions[i].len) &&
+            (_regions[i].address < (uint32_t)address + len))
+            return false;
+    }
+
+    if (!_eeprom.read(address, shadow, len))
+        return false;
+
+    Region& region = _regions[_count];
+
+    interval = (uint64_t)years * GOVERNOR_MS_PER_YEAR / endurance;
+
+    region.address     = address;
+    region.len         = len;
+    region.shadow      = shadow;
+    region.interval_ms = (interval > 0xFFFFFFFF) ? 0xFFFFFFFF : (interval ? (uint32_t)interval : 1);
+    region.elapsed_ms  = 0;
+    region.credit      = burst;
+    region.burst       = burst;
+    region.policy      = policy;
+    region.dirty_start = 0;
+    region.dirty_end   = 0;
+    region.writes      = 0;
+
+    _count++;
+
+    return true;
+}
+
+bool EepromGovernor::write(uint16_t address, const uint8_t * vals, uint16_t len)
+{
+    uint32_t done = 0;
+
+    if ((uint32_t)address + len > _eeprom.size())
+        return false;
+
+    while (done < len)
+    {
+        uint32_t pos   = address + done;
+        int      index = find(pos);
+        uint32_t end   = (index < 0) ? next(pos) : (uint32_t)_regions[index].address + _regions[index].len;
+        uint16_t chunk = (uint16_t)(((end - pos) < (len - done)) ? (end - pos) : (len - done));
+        bool     result;
+
+        if (index < 0)
+            result = _eeprom.write((uint16_t)pos, (uint8_t*)&vals[done], chunk);
+        else
+            result = writeRegion(_regions[index], (uint16_t)(pos - _regions[index].address), &vals[done], chunk);
+
+        if (!result)
+            return false;
+
+        done += chunk;
+    }
+
+    return true;
+}
+
+bool EepromGovernor::read(uint16_t address, uint8_t * vals, uint16_t len)
+{
+    uint32_t done = 0;
+
+    if ((uint32_t)address + len > _eeprom.size())
+        return false;
+
+    while (done < len)
+    {
+        uint32_t pos   = address + done;
+        int      index = find(pos);
+        uint32_t end   = (index < 0) ? next(pos) : (uint32_t)_regions[index].address + _regions[index].len;
+        uint16_t chunk = (uint16_t)(((end - pos) < (len - done)) ? (end - pos) : (len - done));
+
+        if (index >= 0)
+            memcpy(&vals[done], &_regions[index].shadow[pos - _regions[index].address], chunk);
+        else if (!_eeprom.read((uint16_t)pos, &vals[done], chunk))
+            return false;
+
+        done += chunk;
+    }
+
+    return true;
+}
+
+bool EepromGovernor::tick(uint32_t now_ms)
+{
+    uint32_t elapsed;
+
+    if (!_started)
+    {
+        _started = true;
+        _last_ms = now_ms;
+    }
+
+    elapsed  = now_ms - _last_ms;
+    _last_ms = now_ms;
+
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        Region&  region = _regions[i];
+        uint64_t gained;
+
+        region.elapsed_ms += elapsed;
+        gained             = region.elapsed_ms / region.interval_ms;
+        region.elapsed_ms %= region.interval_ms;
+
+        // Credit does not accrue beyond the burst limit, nor does time toward it
+        if ((int64_t)region.credit + (int64_t)gained >= (int64_t)region.burst)
+        {
+            region.credit     = region.burst;
+            region.elapsed_ms = 0;
+        }
+        else
+        {
+            region.credit = (int32_t)(region.credit + (int64_t)gained);
+        }
+
+        if (region.dirty_end && (region.credit > 0) && !commit(region))
+            return false;
+    }
+
+    return true;
+}
+
+bool EepromGovernor::flush()
+{
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        if (!commit(_regions[i]))
+            return false;
+    }
+
+    return true;
+}
+
+bool EepromGovernor::pending(uint8_t region) const
+{
+    return (region < _count) && _regions[region].dirty_end;
+}
+
+// Private: Apply a write within one region according to its budget and policy
+bool EepromGovernor::writeRegion(Region& region, uint16_t offset, const uint8_t * vals, uint16_t len)
+{
+    if (0 == memcmp(&region.shadow[offset], vals, len))
+    {
+        _stats.unchanged++;
+        return true;
+    }
+
+    if ((region.credit <= 0) && (EEPROM_OVERFLOW_REJECT == region.policy))
+    {
+        _stats.rejected++;
+        return false;
+    }
+
+    memcpy(&region.shadow[offset], vals, len);
+
+    if (!region.dirty_end)
+    {
+        region.dirty_start = offset;
+        region.dirty_end   = (uint16_t)(offset + len);
+    }
+    else
+    {
+        if (offset < region.dirty_start)
+            region.dirty_start = offset;
+
+        if (offset + len > region.dirty_end)
+            region.dirty_end = (uint16_t)(offset + len);
+    }
+
+    region.writes++;
+
+    if ((region.credit <= 0) && (EEPROM_OVERFLOW_DEFER == region.policy))
+    {
+        _stats.deferred++;
+        return true;
+    }
+
+    return commit(region);
+}
+
+// Private: Write a region's dirty range, spending one credit; the range stays dirty on I2C error
+bool EepromGovernor::commit(Region& region)
+{
+    if (!region.dirty_end)
+        return true;
+
+    if (!_eeprom.write((uint16_t)(region.address + region.dirty_start), &region.shadow[region.dirty_start],
+                       (uint16_t)(region.dirty_end - region.dirty_start)))
+        return false;
+
+    if (region.credit <= 0)
+        _stats.forced++;
+
+    _stats.commits++;
+    _stats.coalesced  += region.writes - 1;
+    region.credit--;
+    region.dirty_end   = 0;
+    region.writes      = 0;
+
+    return true;
+}
+
+// Private: Index of the region containing an address, or -1
+int EepromGovernor::find(uint32_t address) const
+{
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        if ((address >= _regions[i].address) && (address < (uint32_t)_regions[i].address + _regions[i].len))
+            return i;
+    }
+
+    return -1;
+}
+
+// Private: Start of the first region above an address, or the end of the device
+uint32_t EepromGovernor::next(uint32_t address) const
+{
+    uint32_t end = _eeprom.size();
+
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        if ((_regions[i].address > address) && (_regions[i].address < end))
+            end = _regions[i].address;
+    }
+
+    return end;
+}
+
+}
+
+// EOF
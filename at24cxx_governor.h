@@ -0,0 +1,163 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_governor.h
+// Purpose     : AT24CXX EEPROM Endurance Governor
+// Description :
+//               Bounds wear by giving each governed region a budget of write cycles. A budget follows from the
+//               rated endurance and the lifetime it must last, e.g. 1,000,000 cycles over 10 years allows one
+//               commit every 5.3 minutes on average. Credit accrues at that rate up to a burst limit, so occasional
+//               bursts pass straight through. Each commit writes the region's pages at most once, so it costs
+//               every page in the region one cycle. Regions are page-aligned and span whole pages, so that no
+//               write outside the governor can wear a governed page.
+//
+//               Every region is mirrored in a caller-provided shadow buffer, loaded when the region is added.
+//               Reads of governed addresses are served from the shadow without touching the bus, and writes that
+//               leave the contents unchanged are dropped. While a region has credit, writes go straight through.
+//               Once the credit is exhausted, the overflow policy decides what happens:
+//
+//               - Defer: the write is held in the shadow and coalesced with later writes, so only the latest
+//                 contents are committed by tick() when credit allows.
+//               - Force: the write, along with anything deferred, is committed at once and the credit overdrawn,
+//                 so the debt is repaid from future accrual. Use it for urgent data.
+//               - Reject: the write fails and the shadow is left unchanged.
+//
+//               Addresses outside every region pass straight through. flush() commits all deferred data
+//               regardless of budget, e.g. on power-fail warning. Deferred data is lost on reset, so governed
+//               regions should hold data whose latest value matters rather than its history.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_GOVERNOR_H
+#define _AT24CXX_GOVERNOR_H
+
+#include "at24cxx.h"
+
+// Number of regions one governor can track
+#ifndef AT24CXX_GOVERNOR_REGIONS
+#define AT24CXX_GOVERNOR_REGIONS 4
+#endif
+
+namespace PeripheralIO
+{
+
+enum EepromOverflow
+{
+    EEPROM_OVERFLOW_DEFER  = 0,
+    EEPROM_OVERFLOW_FORCE  = 1,
+    EEPROM_OVERFLOW_REJECT = 2
+};
+
+struct EepromGovernorStats
+{
+    uint32_t commits;   // region writes issued to the device
+    uint32_t deferred;  // writes held in the shadow for later commit
+    uint32_t coalesced; // deferred writes absorbed by a later commit
+    uint32_t forced;    // commits made beyond the budget
+    uint32_t rejected;  // writes refused beyond the budget
+    uint32_t unchanged; // writes dropped as identical to the stored contents
+};
+
+class EepromGovernor
+{
+    public:
+       /**
+        * @brief Constructor for EepromGovernor object
+        * @param eeprom Reference to initialized AT24CXX object
+       */
+        explicit EepromGovernor(AT24CXX& eeprom);
+
+        /**
+         * @brief Govern a region, loading its current contents into the shadow buffer
+         * @param address Page-aligned starting address of the region
+         * @param len Length of the region in bytes; a multiple of the page size
+         * @param shadow Pointer to len bytes of caller-owned RAM, valid for the life of the governor
+         * @param endurance Rated write cycles of each page
+         * @param years Lifetime over which the endurance must last
+         * @param burst Largest number of commits that may be made back to back
+         * @param policy Handling of writes made while the budget is exhausted
+         * @return False for I2C error, overlap with another region, unaligned or invalid arguments, or no free
+         *         region
+        */
+        bool addRegion(uint16_t address, uint16_t len, uint8_t * shadow, uint32_t endurance, uint16_t years,
+                       uint16_t burst, EepromOverflow policy);
+
+        /**
+         * @brief Write through the governor
+         * @param address Starting address
+         * @param vals Pointer to values to write
+         * @param len Number of bytes to write
+         * @return False for I2C error, rejection by a region's policy or invalid request; true otherwise
+        */
+        bool write(uint16_t address, const uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Read through the governor, serving governed addresses from their shadows
+         * @param address Starting address
+         * @param vals Pointer to array into which read values will be placed
+         * @param len Number of bytes to read
+         * @return False for I2C error or invalid request, true otherwise
+        */
+        bool read(uint16_t address, uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Accrue credit and commit deferred regions it covers; call periodically
+         * @param now_ms Current time in milliseconds
+         * @return False for I2C error, true otherwise
+        */
+        bool tick(uint32_t now_ms);
+
+        /**
+         * @brief Commit all deferred data regardless of budget
+         * @return False for I2C error, true otherwise
+        */
+        bool flush();
+
+        /**
+         * @brief Check whether a region holds deferred data
+         * @param region Region index, in order of addition
+        */
+        bool pending(uint8_t region) const;
+
+        /**
+         * @brief Get governor counters
+        */
+        const EepromGovernorStats& stats() const { return _stats; }
+
+    private:
+        struct Region
+        {
+            uint16_t       address;
+            uint16_t       len;
+            uint8_t *      shadow;
+            uint32_t       interval_ms;
+            uint32_t       elapsed_ms;  // time accrued toward the next credit
+            int32_t        credit;
+            uint16_t       burst;
+            EepromOverflow policy;
+            uint16_t       dirty_start;
+            uint16_t       dirty_end;   // zero when nothing is deferred
+            uint32_t       writes;      // writes merged into the dirty range
+        };
+
+        bool     writeRegion(Region& region, uint16_t offset, const uint8_t * vals, uint16_t len);
+        bool     commit(Region& region);
+        int      find(uint32_t address) const;
+        uint32_t next(uint32_t address) const;
+
+        AT24CXX&            _eeprom;
+        Region              _regions[AT24CXX_GOVERNOR_REGIONS];
+        uint8_t             _count;
+        uint32_t            _last_ms;
+        bool                _started;
+        EepromGovernorStats _stats;
+};
+
+}
+
+#endif // _AT24CXX_GOVERNOR_H
+
+// EOF
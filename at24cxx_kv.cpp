@@ -0,0 +1,621 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_kv.cpp
+// Purpose     : AT24CXX EEPROM Key-Value Store
+// Description : This source file implements header file at24cxx_kv.h.
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <string.h>
+#include "at24cxx_kv.h"
+#include "at24cxx_crc.h"
+
+namespace PeripheralIO
+{
+
+// Store Layout Defines
+const uint16_t EEPROM_KV_MAGIC       = 0x4B56; // "KV"
+const uint8_t  EEPROM_KV_REC_HEADER  = 5;      // key(2) len(1) crc(2)
+const uint8_t  EEPROM_KV_TOMBSTONE   = 0xFF;   // len value marking a removed key
+const uint8_t  EEPROM_KV_BLOOM_START = 4;      // filter bits follow generation tag, 4-byte aligned
+const uint8_t  EEPROM_KV_HDR_BYTES   = 8;      // magic(2) generation(2) bank(1) reserved(1) crc(2)
+
+// Private: Mix 16-bit key into 32 well-distributed bits
+static uint32_t bloomHash(uint16_t key)
+{
+    uint32_t h = (uint32_t)key * 0x9E3779B1UL;
+
+    h ^= h >> 16;
+    h *= 0x85EBCA6BUL;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35UL;
+    h ^= h >> 16;
+
+    return h;
+}
+
+
+EepromKV::EepromKV(AT24CXX& eeprom, uint16_t base, uint16_t length)
+: _eeprom(eeprom)
+, _base(base)
+, _page_size(eeprom.pageSize())
+, _bloom_pages(0)
+, _bank_size(0)
+, _tail(0)
+, _bloom_stale(false)
+, _mounted(false)
+, _io_error(false)
+{
+    uint16_t pages = length / _page_size;
+
+    _bloom_pages = (uint16_t)((EEPROM_KV_BLOOM_START + AT24CXX_KV_BLOOM_BYTES + _page_size - 1) / _page_size);
+
+    if (pages > (uint16_t)(1 + _bloom_pages + 1))
+        _bank_size = (uint16_t)(((pages - 1 - _bloom_pages) / 2) * _page_size);
+
+    memset(&_hdr, 0, sizeof(_hdr));
+    memset(_bloom, 0, sizeof(_bloom));
+}
+
+bool EepromKV::format()
+{
+    Header   old;
+    bool     valid;
+    uint16_t generation = 1;
+
+    _mounted  = false;
+    _io_error = false;
+
+    if ((0 == _bank_size) || !loadHeader(old, valid))
+        return false;
+
+    // Skip past any previous generation and the one an interrupted compaction may have written to either bank,
+    // so that none of their records can validate again
+    if (valid)
+        generation = old.generation + 2;
+
+    memset(_bloom, 0, sizeof(_bloom));
+
+    if (!writeBloom(generation) || !writeHeader(generation, 0))
+        return false;
+
+    _tail        = bankStart(0);
+    _bloom_stale = false;
+    _mounted     = true;
+
+    return true;
+}
+
+bool EepromKV::mount()
+{
+    Record   rec;
+    uint8_t  tag[2];
+    bool     valid;
+    uint16_t end;
+
+    _mounted  = false;
+    _io_error = false;
+
+    if ((0 == _bank_size) || !loadHeader(_hdr, valid) || !valid)
+        return false;
+
+    if (!busRead((uint16_t)(_base + _page_size), tag, sizeof(tag)))
+        return false;
+
+    _bloom_stale = ((uint16_t)(tag[0] | (tag[1] << 8)) != _hdr.generation);
+
+    if (_bloom_stale)
+        memset(_bloom, 0, sizeof(_bloom));
+    else if (!busRead((uint16_t)(_base + _page_size + EEPROM_KV_BLOOM_START), _bloom, sizeof(_bloom)))
+        return false;
+
+    // Walk the log to its first invalid record, rebuilding a stale filter on the way
+    _tail = bankStart(_hdr.bank);
+    end   = _tail + _bank_size;
+
+    while (readRecord(_tail, end, rec))
+    {
+        if (_bloom_stale)
+            bloomInsert(rec.key, false);
+
+        _tail += recordSize(rec);
+    }
+
+    // A bus error is not the end of the log; accepting it would truncate the tail and overwrite live records
+    if (_io_error)
+        return false;
+
+    if (_bloom_stale)
+    {
+        if (!writeBloom(_hdr.generation))
+            return false;
+
+        _bloom_stale = false;
+    }
+
+    _mounted = true;
+    return true;
+}
+
+bool EepromKV::clear()
+{
+    _io_error = false;
+
+    if (!_mounted || !writeHeader(_hdr.generation + 1, _hdr.bank))
+        return false;
+
+    // Filter on device now carries the previous generation and is rewritten before its next update
+    memset(_bloom, 0, sizeof(_bloom));
+    _bloom_stale = true;
+    _tail        = bankStart(_hdr.bank);
+
+    return true;
+}
+
+bool EepromKV::put(uint16_t key, const uint8_t * vals, uint8_t len)
+{
+    _io_error = false;
+
+    if (!_mounted || (len > AT24CXX_KV_MAX_VALUE))
+        return false;
+
+    if (((uint32_t)_tail + EEPROM_KV_REC_HEADER + len) > ((uint32_t)bankStart(_hdr.bank) + _bank_size))
+    {
+        if (!compact()
+            || (((uint32_t)_tail + EEPROM_KV_REC_HEADER + len) > ((uint32_t)bankStart(_hdr.bank) + _bank_size)))
+            return false;
+    }
+
+    // Filter is updated first so that it remains a superset of the log after a power loss
+    if (!bloomInsert(key, true))
+        return false;
+
+    return appendRecord(_hdr.generation, _tail, key, vals, len);
+}
+
+bool EepromKV::get(uint16_t key, uint8_t * vals, uint8_t& len)
+{
+    uint16_t addr;
+    Record   rec;
+
+    _io_error = false;
+
+    if (!_mounted || !mayContain(key) || !find(key, addr, rec) || (EEPROM_KV_TOMBSTONE == rec.len))
+        return false;
+
+    if (len > rec.len)
+        len = rec.len;
+
+    if ((len > 0) && !busRead((uint16_t)(addr + EEPROM_KV_REC_HEADER), vals, len))
+        return false;
+
+    len = rec.len;
+    return true;
+}
+
+bool EepromKV::remove(uint16_t key)
+{
+    uint16_t addr;
+    Record   rec;
+
+    _io_error = false;
+
+    if (!_mounted)
+        return false;
+
+    if (!mayContain(key) || !find(key, addr, rec) || (EEPROM_KV_TOMBSTONE == rec.len))
+        return !_io_error;
+
+    if (((uint32_t)_tail + EEPROM_KV_REC_HEADER) > ((uint32_t)bankStart(_hdr.bank) + _bank_size))
+    {
+        // Compaction drops the key's superseded records; only a surviving live value needs a tombstone
+        if (!compact())
+            return false;
+
+        if (!find(key, addr, rec) || (EEPROM_KV_TOMBSTONE == rec.len))
+            return !_io_error;
+
+        if (((uint32_t)_tail + EEPROM_KV_REC_HEADER) > ((uint32_t)bankStart(_hdr.bank) + _bank_size))
+            return false;
+    }
+
+    return appendRecord(_hdr.generation, _tail, key, 0, EEPROM_KV_TOMBSTONE);
+}
+
+bool EepromKV::mayContain(uint16_t key) const
+{
+    uint32_t h     = bloomHash(key);
+    uint16_t block = (uint16_t)((h & 0xFFFF) % (AT24CXX_KV_BLOOM_BYTES / 4)) * 4;
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        uint8_t bit = (uint8_t)((h >> (16 + 5 * i)) & 0x1F);
+
+        if (!(_bloom[block + (bit >> 3)] & (1 << (bit & 7))))
+            return false;
+    }
+
+    return true;
+}
+
+bool EepromKV::compact()
+{
+    Record   batch[AT24CXX_KV_COMPACT_KEYS];
+    uint16_t latest[AT24CXX_KV_COMPACT_KEYS];
+    uint8_t  count;
+    uint8_t  i;
+    uint32_t floor = 0;
+    uint16_t src;
+    uint16_t end;
+    uint16_t dst;
+    uint16_t generation;
+    uint8_t  bank;
+    Record   rec;
+
+    _io_error = false;
+
+    if (!_mounted)
+        return false;
+
+    generation = _hdr.generation + 1;
+    bank       = _hdr.bank ^ 1;
+    dst        = bankStart(bank);
+    end        = _tail;
+
+    // Filter is rebuilt in place; any failure below leaves it incomplete and requires mount() again
+    memset(_bloom, 0, sizeof(_bloom));
+
+    // Each pass over the log gathers the last record of each of the next smallest keys, so the log is read
+    // once per batch of keys rather than once per record
+    do
+    {
+        count = 0;
+
+        for (src = bankStart(_hdr.bank); src < end; src += recordSize(rec))
+        {
+            if (!readHeader(src, rec))
+            {
+                _mounted = false;
+                return false;
+            }
+
+            if (rec.key < floor)
+                continue;
+
+            i = 0;
+
+            while ((i < count) && (batch[i].key < rec.key))
+                i++;
+
+            if ((i < count) && (batch[i].key == rec.key))
+            {
+                batch[i]  = rec;
+                latest[i] = src;
+                continue;
+            }
+
+            // A full batch keeps its smallest keys; larger ones are left to a later pass
+            if (AT24CXX_KV_COMPACT_KEYS == i)
+                continue;
+
+            if (count < AT24CXX_KV_COMPACT_KEYS)
+                count++;
+
+            for (uint8_t j = (uint8_t)(count - 1); j > i; j--)
+            {
+                batch[j]  = batch[j - 1];
+                latest[j] = latest[j - 1];
+            }
+
+            batch[i]  = rec;
+            latest[i] = src;
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            if (EEPROM_KV_TOMBSTONE == batch[i].len)
+                continue;
+
+            // Records carry the new generation and stay invalid until the header switches banks
+            if (!appendCopy(generation, latest[i], batch[i], dst))
+            {
+                _mounted = false;
+                return false;
+            }
+
+            bloomInsert(batch[i].key, false);
+        }
+
+        if (count)
+            floor = (uint32_t)batch[count - 1].key + 1;
+    }
+    while ((AT24CXX_KV_COMPACT_KEYS == count) && (floor <= 0xFFFF));
+
+    if (!writeBloom(generation) || !writeHeader(generation, bank))
+    {
+        _mounted = false;
+        return false;
+    }
+
+    _tail        = dst;
+    _bloom_stale = false;
+
+    return true;
+}
+
+uint16_t EepromKV::freeBytes() const
+{
+    if (!_mounted)
+        return 0;
+
+    return (uint16_t)(bankStart(_hdr.bank) + _bank_size - _tail);
+}
+
+bool EepromKV::ioError() const
+{
+    return _io_error;
+}
+
+// Private: Locate last record of key in the active bank
+bool EepromKV::find(uint16_t key, uint16_t& addr, Record& rec)
+{
+    Record   cur;
+    bool     found = false;
+
+    // Records up to the tail were validated at mount or append; only headers are read
+    for (uint16_t pos = bankStart(_hdr.bank); pos < _tail; pos += recordSize(cur))
+    {
+        if (!readHeader(pos, cur))
+            return false;
+
+        if (cur.key == key)
+        {
+            addr  = pos;
+            rec   = cur;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+// Private: Read record header at addr without validation
+bool EepromKV::readHeader(uint16_t addr, Record& rec)
+{
+    uint8_t raw[EEPROM_KV_REC_HEADER];
+
+    if (!busRead(addr, raw, EEPROM_KV_REC_HEADER))
+        return false;
+
+    rec.key = (uint16_t)(raw[0] | (raw[1] << 8));
+    rec.len = raw[2];
+    rec.crc = (uint16_t)(raw[3] | (raw[4] << 8));
+
+    return true;
+}
+
+// Private: Read record header at addr and verify its CRC against the current generation; a false return is an
+// invalid record marking the end of the log unless _io_error is set
+bool EepromKV::readRecord(uint16_t addr, uint16_t end, Record& rec)
+{
+    uint8_t  chunk[16];
+    uint16_t crc;
+    uint8_t  remaining;
+    uint8_t  n;
+
+    if (((uint32_t)addr + EEPROM_KV_REC_HEADER) > end)
+        return false;
+
+    if (!readHeader(addr, rec))
+        return false;
+
+    if (((EEPROM_KV_TOMBSTONE != rec.len) && (rec.len > AT24CXX_KV_MAX_VALUE))
+        || (((uint32_t)addr + recordSize(rec)) > end))
+        return false;
+
+    crc       = recordCrc(_hdr.generation, rec.key, rec.len, 0);
+    remaining = (EEPROM_KV_TOMBSTONE == rec.len) ? 0 : rec.len;
+    addr     += EEPROM_KV_REC_HEADER;
+
+    while (remaining)
+    {
+        n = (remaining < sizeof(chunk)) ? remaining : sizeof(chunk);
+
+        if (!busRead(addr, chunk, n))
+            return false;
+
+        crc        = crc16Update(crc, chunk, n);
+        addr      += n;
+        remaining -= n;
+    }
+
+    return (crc == rec.crc);
+}
+
+// Private: Write one record at tail in a single write and advance tail
+bool EepromKV::appendRecord(uint16_t generation, uint16_t& tail, uint16_t key, const uint8_t * vals, uint8_t len)
+{
+    uint8_t  buf[EEPROM_KV_REC_HEADER + AT24CXX_KV_MAX_VALUE];
+    uint8_t  data_len = (EEPROM_KV_TOMBSTONE == len) ? 0 : len;
+    uint16_t crc      = recordCrc(generation, key, len, vals);
+
+    buf[0] = (uint8_t)(key & 0xFF);
+    buf[1] = (uint8_t)(key >> 8);
+    buf[2] = len;
+    buf[3] = (uint8_t)(crc & 0xFF);
+    buf[4] = (uint8_t)(crc >> 8);
+
+    if (data_len)
+        memcpy(&buf[EEPROM_KV_REC_HEADER], vals, data_len);
+
+    if (!busWrite(tail, buf, (uint16_t)(EEPROM_KV_REC_HEADER + data_len)))
+        return false;
+
+    tail += (uint16_t)(EEPROM_KV_REC_HEADER + data_len);
+    return true;
+}
+
+// Private: Re-append an existing record under a new generation
+bool EepromKV::appendCopy(uint16_t generation, uint16_t src, const Record& rec, uint16_t& tail)
+{
+    uint8_t vals[AT24CXX_KV_MAX_VALUE];
+
+    if (rec.len && !busRead((uint16_t)(src + EEPROM_KV_REC_HEADER), vals, rec.len))
+        return false;
+
+    return appendRecord(generation, tail, rec.key, vals, rec.len);
+}
+
+// Private: Read and decode little-endian header, checking magic, bank and CRC
+bool EepromKV::loadHeader(Header& hdr, bool& valid)
+{
+    uint8_t raw[EEPROM_KV_HDR_BYTES];
+
+    valid = false;
+
+    if (!busRead(_base, raw, sizeof(raw)))
+        return false;
+
+    hdr.magic      = (uint16_t)(raw[0] | (raw[1] << 8));
+    hdr.generation = (uint16_t)(raw[2] | (raw[3] << 8));
+    hdr.bank       = raw[4];
+    hdr.reserved   = raw[5];
+    hdr.crc        = (uint16_t)(raw[6] | (raw[7] << 8));
+    valid          = (EEPROM_KV_MAGIC == hdr.magic) && (crc16(raw, 6) == hdr.crc) && (hdr.bank <= 1);
+
+    return true;
+}
+
+// Private: Persist little-endian header selecting generation and active bank
+bool EepromKV::writeHeader(uint16_t generation, uint8_t bank)
+{
+    uint8_t raw[EEPROM_KV_HDR_BYTES];
+    Header  hdr;
+
+    hdr.magic      = EEPROM_KV_MAGIC;
+    hdr.generation = generation;
+    hdr.bank       = bank;
+    hdr.reserved   = 0;
+
+    raw[0] = (uint8_t)(hdr.magic & 0xFF);
+    raw[1] = (uint8_t)(hdr.magic >> 8);
+    raw[2] = (uint8_t)(hdr.generation & 0xFF);
+    raw[3] = (uint8_t)(hdr.generation >> 8);
+    raw[4] = hdr.bank;
+    raw[5] = hdr.reserved;
+
+    hdr.crc = crc16(raw, 6);
+    raw[6]  = (uint8_t)(hdr.crc & 0xFF);
+    raw[7]  = (uint8_t)(hdr.crc >> 8);
+
+    if (!busWrite(_base, raw, sizeof(raw)))
+        return false;
+
+    _hdr = hdr;
+    return true;
+}
+
+// Private: Persist complete RAM filter tagged with generation
+bool EepromKV::writeBloom(uint16_t generation)
+{
+    uint16_t addr = (uint16_t)(_base + _page_size);
+    uint8_t  tag[2];
+
+    if (!busWrite((uint16_t)(addr + EEPROM_KV_BLOOM_START), _bloom, sizeof(_bloom)))
+        return false;
+
+    tag[0] = (uint8_t)(generation & 0xFF);
+    tag[1] = (uint8_t)(generation >> 8);
+
+    // Tag last, so a torn filter is detected as stale
+    return busWrite(addr, tag, sizeof(tag));
+}
+
+// Private: Set key's bits in RAM filter, optionally writing back the changed 32-bit block
+bool EepromKV::bloomInsert(uint16_t key, bool persist)
+{
+    uint32_t h       = bloomHash(key);
+    uint16_t block   = (uint16_t)((h & 0xFFFF) % (AT24CXX_KV_BLOOM_BYTES / 4)) * 4;
+    bool     changed = false;
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        uint8_t bit  = (uint8_t)((h >> (16 + 5 * i)) & 0x1F);
+        uint8_t mask = (uint8_t)(1 << (bit & 7));
+
+        if (!(_bloom[block + (bit >> 3)] & mask))
+        {
+            _bloom[block + (bit >> 3)] |= mask;
+            changed = true;
+        }
+    }
+
+    if (!persist || !changed)
+        return true;
+
+    if (_bloom_stale)
+    {
+        if (!writeBloom(_hdr.generation))
+            return false;
+
+        _bloom_stale = false;
+        return true;
+    }
+
+    return busWrite((uint16_t)(_base + _page_size + EEPROM_KV_BLOOM_START + block), &_bloom[block], 4);
+}
+
+// Private: Read from the device, noting a bus failure for ioError()
+bool EepromKV::busRead(uint16_t address, uint8_t * vals, uint16_t len)
+{
+    if (_eeprom.read(address, vals, len))
+        return true;
+
+    _io_error = true;
+    return false;
+}
+
+// Private: Write to the device, noting a bus failure for ioError()
+bool EepromKV::busWrite(uint16_t address, uint8_t * vals, uint16_t len)
+{
+    if (_eeprom.write(address, vals, len))
+        return true;
+
+    _io_error = true;
+    return false;
+}
+
+uint16_t EepromKV::recordCrc(uint16_t generation, uint16_t key, uint8_t len, const uint8_t * vals) const
+{
+    uint8_t  prefix[5];
+    uint16_t crc;
+
+    prefix[0] = (uint8_t)(generation & 0xFF);
+    prefix[1] = (uint8_t)(generation >> 8);
+    prefix[2] = (uint8_t)(key & 0xFF);
+    prefix[3] = (uint8_t)(key >> 8);
+    prefix[4] = len;
+
+    crc = crc16(prefix, sizeof(prefix));
+
+    if (vals && (EEPROM_KV_TOMBSTONE != len))
+        crc = crc16Update(crc, vals, len);
+
+    return crc;
+}
+
+uint16_t EepromKV::bankStart(uint8_t bank) const
+{
+    return (uint16_t)(_base + (1 + _bloom_pages) * _page_size + bank * _bank_size);
+}
+
+uint16_t EepromKV::recordSize(const Record& rec) const
+{
+    return (uint16_t)(EEPROM_KV_REC_HEADER + ((EEPROM_KV_TOMBSTONE == rec.len) ? 0 : rec.len));
+}
+
+}
+
+// EOF
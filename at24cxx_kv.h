@@ -0,0 +1,176 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_kv.h
+// Purpose     : AT24CXX EEPROM Key-Value Store
+// Description :
+//               Log-structured key-value store for small values addressed by 16-bit keys. Records are appended to
+//               the active of two log banks and superseded by later records of the same key; compaction copies the
+//               live records into the other bank and switches banks by rewriting a single header page.
+//
+//               A blocked Bloom filter is persisted beside the log and cached in RAM, so that lookups of absent
+//               keys are answered without any bus transaction. All hash bits of a key fall in one aligned 32-bit
+//               block, which keeps the incremental filter update on insert to a single small write that never
+//               straddles a page. The filter is rebuilt from the surviving records during compaction, and rebuilt
+//               at mount if it is found stale with respect to the header generation.
+//
+//               Every record carries a CRC-16 which also covers the header generation, so advancing the
+//               generation (clear(), compaction) invalidates all older records at once.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_KV_H
+#define _AT24CXX_KV_H
+
+#include "at24cxx.h"
+
+// Size of the RAM-cached Bloom filter in bytes; must be a multiple of 4
+#ifndef AT24CXX_KV_BLOOM_BYTES
+#define AT24CXX_KV_BLOOM_BYTES 64
+#endif
+
+// Largest value accepted by put(); bounds the stack buffer used to append a record in one write
+#ifndef AT24CXX_KV_MAX_VALUE
+#define AT24CXX_KV_MAX_VALUE 32
+#endif
+
+// Distinct keys gathered per pass over the log during compaction; more keys cost additional passes
+#ifndef AT24CXX_KV_COMPACT_KEYS
+#define AT24CXX_KV_COMPACT_KEYS 16
+#endif
+
+namespace PeripheralIO
+{
+
+class EepromKV
+{
+    public:
+       /**
+        * @brief Constructor for EepromKV object
+        * @param eeprom Reference to initialized AT24CXX object
+        * @param base Page-aligned starting address of the region managed by the store
+        * @param length Length of the region in bytes
+       */
+        EepromKV(AT24CXX& eeprom, uint16_t base, uint16_t length);
+
+        /**
+         * @brief Initialize an empty store, invalidating any previous contents of the region
+         * @return False for I2C error or region too small, true otherwise
+        */
+        bool format();
+
+        /**
+         * @brief Load header and Bloom filter and locate the end of the log; must be called prior to use
+         * @return False if no valid store is present (format() required) or I2C error, true otherwise;
+         *         ioError() tells the two apart
+        */
+        bool mount();
+
+        /**
+         * @brief Discard all records by advancing the generation; costs a single header page write
+         * @return False for I2C error or store not mounted, true otherwise
+        */
+        bool clear();
+
+        /**
+         * @brief Store value under key, superseding any previous value
+         * @param key Key of value
+         * @param vals Pointer to value bytes
+         * @param len Length of value, at most AT24CXX_KV_MAX_VALUE
+         * @return False for I2C error, oversized value, or store full after compaction; true otherwise
+        */
+        bool put(uint16_t key, const uint8_t * vals, uint8_t len);
+
+        /**
+         * @brief Retrieve value stored under key
+         * @param key Key of value
+         * @param vals Pointer to array into which the value will be placed
+         * @param len In: capacity of vals; out: length of stored value
+         * @return False if key is absent or I2C error, true otherwise
+        */
+        bool get(uint16_t key, uint8_t * vals, uint8_t& len);
+
+        /**
+         * @brief Remove key from the store
+         * @param key Key to remove
+         * @return False for I2C error or store full after compaction, true otherwise (including absent key)
+        */
+        bool remove(uint16_t key);
+
+        /**
+         * @brief Check Bloom filter for key without bus access
+         * @param key Key to check
+         * @return False if key is definitely absent, true if it may be present
+        */
+        bool mayContain(uint16_t key) const;
+
+        /**
+         * @brief Copy live records into the inactive bank and rebuild the Bloom filter
+         * @return False for I2C error, true otherwise
+        */
+        bool compact();
+
+        /**
+         * @brief Get number of bytes remaining in the active log bank
+        */
+        uint16_t freeBytes() const;
+
+        /**
+         * @brief Check whether the last failed operation failed on the bus rather than on store contents
+         * @return True if an I2C error occurred during the most recent operation, false otherwise
+        */
+        bool ioError() const;
+
+    private:
+        struct Header
+        {
+            uint16_t magic;
+            uint16_t generation;
+            uint8_t  bank;
+            uint8_t  reserved;
+            uint16_t crc;
+        };
+
+        struct Record
+        {
+            uint16_t key;
+            uint8_t  len;
+            uint16_t crc;
+        };
+
+        bool     find(uint16_t key, uint16_t& addr, Record& rec);
+        bool     loadHeader(Header& hdr, bool& valid);
+        bool     readHeader(uint16_t addr, Record& rec);
+        bool     readRecord(uint16_t addr, uint16_t end, Record& rec);
+        bool     busRead(uint16_t address, uint8_t * vals, uint16_t len);
+        bool     busWrite(uint16_t address, uint8_t * vals, uint16_t len);
+        bool     appendRecord(uint16_t generation, uint16_t& tail, uint16_t key, const uint8_t * vals, uint8_t len);
+        bool     appendCopy(uint16_t generation, uint16_t src, const Record& rec, uint16_t& tail);
+        bool     writeHeader(uint16_t generation, uint8_t bank);
+        bool     writeBloom(uint16_t generation);
+        bool     bloomInsert(uint16_t key, bool persist);
+        uint16_t recordCrc(uint16_t generation, uint16_t key, uint8_t len, const uint8_t * vals) const;
+        uint16_t bankStart(uint8_t bank) const;
+        uint16_t recordSize(const Record& rec) const;
+
+        AT24CXX& _eeprom;
+        Header   _hdr;
+        uint16_t _base;
+        uint16_t _page_size;
+        uint16_t _bloom_pages;
+        uint16_t _bank_size;
+        uint16_t _tail;
+        bool     _bloom_stale;
+        bool     _mounted;
+        bool     _io_error;
+        uint8_t  _bloom[AT24CXX_KV_BLOOM_BYTES];
+};
+
+}
+
+#endif // _AT24CXX_KV_H
+
+// EOF
@@ -0,0 +1,137 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_offload.cpp
+// Purpose     : AT24CXX EEPROM I/O Offload
+// Description : This source file implements header file at24cxx_offload.h.
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include "at24cxx_offload.h"
+
+#ifdef AT24CXX_OFFLOAD
+
+namespace PeripheralIO
+{
+
+EepromOffload::EepromOffload(AT24CXX& eeprom)
+: _eeprom(eeprom)
+, _queue(eeprom)
+, _fenced(false)
+, _failed(false)
+, _fence_tag(0)
+{ }
+
+bool EepromOffload::submitWrite(uint16_t address, const uint8_t * vals, uint16_t len, uint32_t tag)
+{
+    EepromOffloadRequest request;
+
+    request.vals    = (uint8_t*)vals;
+    request.address = address;
+    request.len     = len;
+    request.tag     = tag;
+    request.op      = EEPROM_OFFLOAD_WRITE;
+
+    return _submissions.push(request);
+}
+
+bool EepromOffload::submitRead(uint16_t address, uint8_t * vals, uint16_t len, uint32_t tag)
+{
+    EepromOffloadRequest request;
+
+    request.vals    = vals;
+    request.address = address;
+    request.len     = len;
+    request.tag     = tag;
+    request.op      = EEPROM_OFFLOAD_READ;
+
+    return _submissions.push(request);
+}
+
+bool EepromOffload::submitFence(uint32_t tag)
+{
+    EepromOffloadRequest request;
+
+    request.vals    = nullptr;
+    request.address = 0;
+    request.len     = 0;
+    request.tag     = tag;
+    request.op      = EEPROM_OFFLOAD_FENCE;
+
+    return _submissions.push(request);
+}
+
+bool EepromOffload::runOnce()
+{
+    EepromOffloadRequest request;
+    bool                 result;
+
+    // Completions are posted in submission order, so a full completion ring holds back further work
+    while (!_completions.full())
+    {
+        if (_fenced)
+        {
+            if (!_failed && (_queue.pending() || _eeprom.busy()))
+                break;
+
+            complete(_fence_tag, EEPROM_OFFLOAD_FENCE, !_failed);
+            _fenced = false;
+            _failed = false;
+            continue;
+        }
+
+        if (!_submissions.pop(request))
+            break;
+
+        if (EEPROM_OFFLOAD_WRITE == request.op)
+        {
+            complete(request.tag, request.op, _queue.write(request.address, request.vals, request.len));
+        }
+        else if (EEPROM_OFFLOAD_READ == request.op)
+        {
+            complete(request.tag, request.op, _queue.read(request.address, request.vals, request.len));
+        }
+        else if (EEPROM_OFFLOAD_FENCE == request.op)
+        {
+            // Queue keeps the ordering even after a failed fence stops holding back later submissions
+            _queue.fence();
+            _fenced    = true;
+            _fence_tag = request.tag;
+        }
+        else
+        {
+            complete(request.tag, request.op, false);
+        }
+    }
+
+    result = _queue.poll();
+
+    if (!result && _fenced)
+        _failed = true;
+
+    return result;
+}
+
+bool EepromOffload::idle() const
+{
+    return !_fenced && !_queue.pending() && !_queue.readsPending() && _submissions.empty();
+}
+
+// Private: Post a completion; the caller has checked for space
+void EepromOffload::complete(uint32_t tag, uint8_t op, bool ok)
+{
+    EepromOffloadCompletion completion;
+
+    completion.tag = tag;
+    completion.op  = op;
+    completion.ok  = ok;
+
+    _completions.push(completion);
+}
+
+}
+
+#endif // AT24CXX_OFFLOAD
+
+// EOF
@@ -0,0 +1,212 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_offload.h
+// Purpose     : AT24CXX EEPROM I/O Offload
+// Description :
+//               Moves all EEPROM traffic to a dedicated I/O core or thread. The application side submits requests
+//               into a lock-free single-producer/single-consumer submission ring and reaps results from a second
+//               ring of completions, so it never touches the bus or waits through a write cycle. The I/O side calls
+//               runOnce() in its own loop. It drains submissions into an EepromQueue, which provides coalescing,
+//               read forwarding and idle-time page commits, and posts completions.
+//
+//               Completions carry the caller's tag and are posted in submission order:
+//
+//               - A write completes once its data has been copied into the queue, after which the caller's
+//                 buffer may be reused. Writes are committed later.
+//               - A read completes with its buffer filled, observing every write submitted before it.
+//               - A fence completes once every write submitted before it has finished its write cycle, i.e. is
+//                 durable. The I/O side holds later submissions until then. A fence completes as failed if a commit
+//                 fails meanwhile; the failed write stays queued and is retried.
+//
+//               Each ring is owned by exactly one producer and one consumer, with std::atomic indices using
+//               acquire/release ordering, so no lock or interrupt masking is needed. Both sides must only be
+//               driven from their own core or thread. On a dual-core MCU the I/O core should build the driver with
+//               AT24CXX_DEFERRED_WRITE_CYCLE so that runOnce() returns while the device programs; on Linux
+//               runOnce() may simply run in a std::thread.
+//
+//               The module requires <atomic>, so it is compiled only when AT24CXX_OFFLOAD is defined for the
+//               whole build.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : <atomic>
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_OFFLOAD_H
+#define _AT24CXX_OFFLOAD_H
+
+#ifdef AT24CXX_OFFLOAD
+
+#include <atomic>
+#include "at24cxx_queue.h"
+
+// Entries in each of the submission and completion rings; must be a power of two
+#ifndef AT24CXX_OFFLOAD_DEPTH
+#define AT24CXX_OFFLOAD_DEPTH 16
+#endif
+
+namespace PeripheralIO
+{
+
+enum EepromOffloadOp
+{
+    EEPROM_OFFLOAD_WRITE = 1,
+    EEPROM_OFFLOAD_READ  = 2,
+    EEPROM_OFFLOAD_FENCE = 3
+};
+
+struct EepromOffloadRequest
+{
+    uint8_t * vals;     // write source or read destination
+    uint16_t  address;
+    uint16_t  len;
+    uint32_t  tag;
+    uint8_t   op;       // EepromOffloadOp
+};
+
+struct EepromOffloadCompletion
+{
+    uint32_t tag;
+    uint8_t  op;        // EepromOffloadOp
+    bool     ok;
+};
+
+template <typename T, uint16_t N>
+class EepromSpscRing
+{
+    static_assert(N && !(N & (N - 1)) && (N <= 0x8000), "ring depth must be a power of two");
+
+    public:
+        EepromSpscRing() : _head(0), _tail(0) { }
+
+        /**
+         * @brief Append an item; producer side only
+         * @return False if the ring is full, true otherwise
+        */
+        bool push(const T& item)
+        {
+            uint16_t head = _head.load(std::memory_order_relaxed);
+
+            if ((uint16_t)(head - _tail.load(std::memory_order_acquire)) == N)
+                return false;
+
+            _items[head & (N - 1)] = item;
+            _head.store((uint16_t)(head + 1), std::memory_order_release);
+
+            return true;
+        }
+
+        /**
+         * @brief Remove the oldest item; consumer side only
+         * @return False if the ring is empty, true otherwise
+        */
+        bool pop(T& item)
+        {
+            uint16_t tail = _tail.load(std::memory_order_relaxed);
+
+            if (tail == _head.load(std::memory_order_acquire))
+                return false;
+
+            item = _items[tail & (N - 1)];
+            _tail.store((uint16_t)(tail + 1), std::memory_order_release);
+
+            return true;
+        }
+
+        /**
+         * @brief Check whether the ring is full; exact on the producer side
+        */
+        bool full() const
+        {
+            return (uint16_t)(_head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_acquire)) == N;
+        }
+
+        /**
+         * @brief Check whether the ring is empty; exact on the consumer side
+        */
+        bool empty() const
+        {
+            return _tail.load(std::memory_order_relaxed) == _head.load(std::memory_order_acquire);
+        }
+
+    private:
+        T                     _items[N];
+        std::atomic<uint16_t> _head;
+        std::atomic<uint16_t> _tail;
+};
+
+class EepromOffload
+{
+    public:
+       /**
+        * @brief Constructor for EepromOffload object
+        * @param eeprom Reference to initialized AT24CXX object, used by the I/O side only
+       */
+        explicit EepromOffload(AT24CXX& eeprom);
+
+        /**
+         * @brief Submit a write; application side
+         * @param address Starting address to which values should be written
+         * @param vals Pointer to values, which must remain valid until the write completes
+         * @param len Number of bytes to write
+         * @param tag Caller value returned in the completion
+         * @return False if the submission ring is full, true otherwise
+        */
+        bool submitWrite(uint16_t address, const uint8_t * vals, uint16_t len, uint32_t tag=0);
+
+        /**
+         * @brief Submit a read; application side
+         * @param address Address from which values should be read
+         * @param vals Pointer to array into which read values will be placed, valid until the read completes
+         * @param len Number of bytes to read
+         * @param tag Caller value returned in the completion
+         * @return False if the submission ring is full, true otherwise
+        */
+        bool submitRead(uint16_t address, uint8_t * vals, uint16_t len, uint32_t tag=0);
+
+        /**
+         * @brief Submit a durability barrier for all writes submitted before it; application side
+         * @param tag Caller value returned in the completion
+         * @return False if the submission ring is full, true otherwise
+        */
+        bool submitFence(uint32_t tag=0);
+
+        /**
+         * @brief Take the oldest completion; application side
+         * @param completion Completion to fill
+         * @return False if none is available, true otherwise
+        */
+        bool reap(EepromOffloadCompletion& completion) { return _completions.pop(completion); }
+
+        /**
+         * @brief Process submissions and advance the queue by one step; I/O side, call in a loop
+         * @return False for I2C error committing a write, true otherwise
+        */
+        bool runOnce();
+
+        /**
+         * @brief Check whether the I/O side has nothing left to do, e.g. before sleeping; I/O side
+        */
+        bool idle() const;
+
+    private:
+        void complete(uint32_t tag, uint8_t op, bool ok);
+
+        AT24CXX&     _eeprom;
+        EepromQueue  _queue;
+        bool         _fenced;    // fence awaiting durability
+        bool         _failed;    // commit failed while fenced
+        uint32_t     _fence_tag;
+
+        EepromSpscRing<EepromOffloadRequest, AT24CXX_OFFLOAD_DEPTH>    _submissions;
+        EepromSpscRing<EepromOffloadCompletion, AT24CXX_OFFLOAD_DEPTH> _completions;
+};
+
+}
+
+#endif // AT24CXX_OFFLOAD
+
+#endif // _AT24CXX_OFFLOAD_H
+
+// EOF
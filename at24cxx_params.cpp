@@ -0,0 +1,124 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_params.cpp
+// Purpose     : AT24CXX EEPROM Sparse Parameter Overrides
+// Description : This source file implements header file at24cxx_params.h.
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <string.h>
+#include "at24cxx_params.h"
+
+namespace PeripheralIO
+{
+
+EepromParams::EepromParams(EepromKV& overrides, const EepromParamDefault * defaults, uint16_t count)
+: _kv(overrides)
+, _defaults(defaults)
+, _count(count)
+{ }
+
+bool EepromParams::begin()
+{
+    if (_kv.mount())
+        return true;
+
+    // Only a missing or corrupt store is formatted; a bus error must not discard the overrides
+    return !_kv.ioError() && _kv.format();
+}
+
+bool EepromParams::get(uint16_t key, uint8_t * vals, uint8_t len)
+{
+    const EepromParamDefault * def = lookup(key);
+    uint8_t                    stored = len;
+
+    if (!def || (def->len != len))
+        return false;
+
+    // Overrides of a stale size (from an earlier table) are ignored in favor of the default
+    if (_kv.get(key, vals, stored))
+    {
+        if (stored == len)
+            return true;
+    }
+    else if (_kv.ioError())
+        return false;
+
+    memcpy(vals, def->value, len);
+    return true;
+}
+
+bool EepromParams::set(uint16_t key, const uint8_t * vals, uint8_t len)
+{
+    const EepromParamDefault * def = lookup(key);
+    uint8_t                    current[AT24CXX_KV_MAX_VALUE];
+    uint8_t                    stored = sizeof(current);
+    bool                       overridden;
+
+    if (!def || (def->len != len))
+        return false;
+
+    overridden = _kv.get(key, current, stored);
+
+    if (!overridden && _kv.ioError())
+        return false;
+
+    if (0 == memcmp(vals, def->value, len))
+        return overridden ? _kv.remove(key) : true;
+
+    // Unchanged override costs no write cycle
+    if (overridden && (stored == len) && (0 == memcmp(vals, current, len)))
+        return true;
+
+    return _kv.put(key, vals, len);
+}
+
+bool EepromParams::reset(uint16_t key)
+{
+    if (!lookup(key))
+        return false;
+
+    return _kv.remove(key);
+}
+
+bool EepromParams::factoryReset()
+{
+    return _kv.clear();
+}
+
+bool EepromParams::isOverridden(uint16_t key)
+{
+    uint8_t current[AT24CXX_KV_MAX_VALUE];
+    uint8_t stored = sizeof(current);
+
+    return lookup(key) && _kv.get(key, current, stored);
+}
+
+// Private: Binary search of default table
+const EepromParamDefault * EepromParams::lookup(uint16_t key) const
+{
+    uint16_t lo = 0;
+    uint16_t hi = _count;
+    uint16_t mid;
+
+    while (lo < hi)
+    {
+        mid = (uint16_t)((lo + hi) / 2);
+
+        if (_defaults[mid].key == key)
+            return &_defaults[mid];
+
+        if (_defaults[mid].key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return 0;
+}
+
+}
+
+// EOF
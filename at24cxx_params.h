@@ -0,0 +1,117 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_params.h
+// Purpose     : AT24CXX EEPROM Sparse Parameter Overrides
+// Description :
+//               Parameter store in which default values live in a constant table in program memory and only the
+//               parameters changed from their defaults are kept in EEPROM, as records of an EepromKV override
+//               log. Boot therefore reads just the override region, typically a single page of records plus the
+//               override filter, rather than a full parameter block; a parameter with no override is answered from
+//               the default table without bus access. Setting a parameter back to its default drops its override,
+//               and factoryReset() discards every override with a single header page write.
+//
+//               The default table must be sorted by ascending key; each parameter has the fixed size given by its
+//               default entry.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_PARAMS_H
+#define _AT24CXX_PARAMS_H
+
+#include "at24cxx_kv.h"
+
+namespace PeripheralIO
+{
+
+// Default table entry; typically declared static const so that the table is placed in program memory
+struct EepromParamDefault
+{
+    uint16_t        key;
+    uint8_t         len;
+    const uint8_t * value;
+};
+
+class EepromParams
+{
+    public:
+       /**
+        * @brief Constructor for EepromParams object
+        * @param overrides Reference to EepromKV holding the overridden values
+        * @param defaults Pointer to default table sorted by ascending key
+        * @param count Number of entries in default table
+       */
+        EepromParams(EepromKV& overrides, const EepromParamDefault * defaults, uint16_t count);
+
+        /**
+         * @brief Mount the override store, formatting it if no valid store is present; an I2C error during
+         *        mount fails without formatting, so that a bus fault cannot discard the overrides
+         * @return False for I2C error, true otherwise
+        */
+        bool begin();
+
+        /**
+         * @brief Read parameter value, from its override if present or else from its default
+         * @param key Parameter key
+         * @param vals Pointer to array into which the value will be placed
+         * @param len Size of parameter in bytes; must match its default entry
+         * @return False for unknown key, size mismatch, or I2C error; true otherwise
+        */
+        bool get(uint16_t key, uint8_t * vals, uint8_t len);
+
+        /**
+         * @brief Set parameter value; a value equal to the default removes the override
+         * @param key Parameter key
+         * @param vals Pointer to new value
+         * @param len Size of parameter in bytes; must match its default entry
+         * @return False for unknown key, size mismatch, or I2C error; true otherwise
+        */
+        bool set(uint16_t key, const uint8_t * vals, uint8_t len);
+
+        /**
+         * @brief Restore single parameter to its default
+         * @param key Parameter key
+         * @return False for unknown key or I2C error, true otherwise
+        */
+        bool reset(uint16_t key);
+
+        /**
+         * @brief Restore all parameters to their defaults with a single page write
+         * @return False for I2C error, true otherwise
+        */
+        bool factoryReset();
+
+        /**
+         * @brief Check whether parameter currently holds an override
+         * @param key Parameter key
+        */
+        bool isOverridden(uint16_t key);
+
+        /**
+         * @brief Read parameter into object of matching type
+        */
+        template <typename T>
+        bool get(uint16_t key, T& value) { return get(key, (uint8_t*)&value, (uint8_t)sizeof(T)); }
+
+        /**
+         * @brief Set parameter from object of matching type
+        */
+        template <typename T>
+        bool set(uint16_t key, const T& value) { return set(key, (const uint8_t*)&value, (uint8_t)sizeof(T)); }
+
+    private:
+        const EepromParamDefault * lookup(uint16_t key) const;
+
+        EepromKV&                  _kv;
+        const EepromParamDefault * _defaults;
+        uint16_t                   _count;
+};
+
+}
+
+#endif // _AT24CXX_PARAMS_H
+
+// EOF
@@ -0,0 +1,407 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_partition.cpp
+// Purpose     : AT24CXX EEPROM Partition Table
+// Description : This source file implements header file at24cxx_partition.h.
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <string.h>
+#include "at24cxx_partition.h"
+#include "at24cxx_crc.h"
+
+namespace PeripheralIO
+{
+
+// Stored table: magic(2) count(1) entries[count](name(8) base(2) pages(2) flags(1) cache_pages(1)) crc(2)
+const uint16_t PARTITION_MAGIC       = 0x5450;
+const uint16_t PARTITION_HEADER_SIZE = 3;
+const uint16_t PARTITION_ENTRY_SIZE  = AT24CXX_PARTITION_NAME + 6;
+
+const uint8_t  PARTITION_FLAGS_MASK  = EEPROM_PART_WRITE_BACK | EEPROM_PART_CRC | EEPROM_PART_READ_ONLY;
+const uint16_t PARTITION_NO_PAGE     = 0xFFFF;
+
+EepromPartitionTable::EepromPartitionTable(AT24CXX& eeprom)
+: _eeprom(eeprom)
+, _count(0)
+{ }
+
+bool EepromPartitionTable::add(const char * name, uint16_t base, uint16_t pages, uint8_t flags,
+                               uint8_t cache_pages)
+{
+    EepromPartitionInfo info;
+    uint16_t            page_size = _eeprom.pageSize();
+
+    if ((_count >= AT24CXX_PARTITION_MAX) || !name || !name[0] || (strlen(name) >= AT24CXX_PARTITION_NAME) ||
+        find(name))
+        return false;
+
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        if ((base < (uint32_t)_parts[i].base + (uint32_t)_parts[i].pages * page_size) &&
+            (_parts[i].base < (uint32_t)base + (uint32_t)pages * page_size))
+            return false;
+    }
+
+    memset(&info, 0, sizeof(info));
+    strcpy(info.name, name);
+    info.base        = base;
+    info.pages       = pages;
+    info.flags       = flags;
+    info.cache_pages = cache_pages;
+
+    if (!valid(info))
+        return false;
+
+    _parts[_count++] = info;
+
+    return true;
+}
+
+bool EepromPartitionTable::store(uint16_t address)
+{
+    uint8_t  table[PARTITION_HEADER_SIZE + AT24CXX_PARTITION_MAX * PARTITION_ENTRY_SIZE + 2];
+    uint16_t len = (uint16_t)(storedSize() - 2);
+    uint16_t crc;
+
+    table[0] = (uint8_t)(PARTITION_MAGIC & 0xFF);
+    table[1] = (uint8_t)(PARTITION_MAGIC >> 8);
+    table[2] = _count;
+
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        uint8_t * entry = &table[PARTITION_HEADER_SIZE + i * PARTITION_ENTRY_SIZE];
+
+        memcpy(entry, _parts[i].name, AT24CXX_PARTITION_NAME);
+        entry[AT24CXX_PARTITION_NAME]     = (uint8_t)(_parts[i].base & 0xFF);
+        entry[AT24CXX_PARTITION_NAME + 1] = (uint8_t)(_parts[i].base >> 8);
+        entry[AT24CXX_PARTITION_NAME + 2] = (uint8_t)(_parts[i].pages & 0xFF);
+        entry[AT24CXX_PARTITION_NAME + 3] = (uint8_t)(_parts[i].pages >> 8);
+        entry[AT24CXX_PARTITION_NAME + 4] = _parts[i].flags;
+        entry[AT24CXX_PARTITION_NAME + 5] = _parts[i].cache_pages;
+    }
+
+    crc = crc16(table, len);
+    table[len]     = (uint8_t)(crc & 0xFF);
+    table[len + 1] = (uint8_t)(crc >> 8);
+
+    return _eeprom.write(address, table, (uint16_t)(len + 2));
+}
+
+bool EepromPartitionTable::load(uint16_t address)
+{
+    uint8_t             table[PARTITION_HEADER_SIZE + AT24CXX_PARTITION_MAX * PARTITION_ENTRY_SIZE + 2];
+    EepromPartitionInfo saved[AT24CXX_PARTITION_MAX];
+    uint8_t             saved_count = _count;
+    uint16_t            len;
+
+    if (!_eeprom.read(address, table, PARTITION_HEADER_SIZE))
+        return false;
+
+    if (((uint16_t)(table[0] | (table[1] << 8)) != PARTITION_MAGIC) || (table[2] > AT24CXX_PARTITION_MAX))
+        return false;
+
+    len = (uint16_t)(PARTITION_HEADER_SIZE + table[2] * PARTITION_ENTRY_SIZE);
+
+    if (!_eeprom.read((uint16_t)(address + PARTITION_HEADER_SIZE), &table[PARTITION_HEADER_SIZE],
+                      (uint16_t)(len - PARTITION_HEADER_SIZE + 2)))
+        return false;
+
+    if (crc16(table, len) != (uint16_t)(table[len] | (table[len + 1] << 8)))
+        return false;
+
+    // Entries pass through add() so that a stored table is held to the same rules as a built one
+    memcpy(saved, _parts, sizeof(saved));
+    _count = 0;
+
+    for (uint8_t i = 0; i < table[2]; i++)
+    {
+        const uint8_t * entry = &table[PARTITION_HEADER_SIZE + i * PARTITION_ENTRY_SIZE];
+        char            name[AT24CXX_PARTITION_NAME];
+
+        memcpy(name, entry, AT24CXX_PARTITION_NAME);
+        name[AT24CXX_PARTITION_NAME - 1] = 0;
+
+        if (!add(name,
+                 (uint16_t)(entry[AT24CXX_PARTITION_NAME] | (entry[AT24CXX_PARTITION_NAME + 1] << 8)),
+                 (uint16_t)(entry[AT24CXX_PARTITION_NAME + 2] | (entry[AT24CXX_PARTITION_NAME + 3] << 8)),
+                 entry[AT24CXX_PARTITION_NAME + 4], entry[AT24CXX_PARTITION_NAME + 5]))
+        {
+            memcpy(_parts, saved, sizeof(saved));
+            _count = saved_count;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const EepromPartitionInfo * EepromPartitionTable::find(const char * name) const
+{
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        if (0 == strncmp(_parts[i].name, name, AT24CXX_PARTITION_NAME))
+            return &_parts[i];
+    }
+
+    return nullptr;
+}
+
+uint16_t EepromPartitionTable::storedSize() const
+{
+    return (uint16_t)(PARTITION_HEADER_SIZE + _count * PARTITION_ENTRY_SIZE + 2);
+}
+
+// Private: Check partition geometry and policy against the chip
+bool EepromPartitionTable::valid(const EepromPartitionInfo& info) const
+{
+    uint16_t page_size = _eeprom.pageSize();
+
+    return info.pages && !(info.base % page_size) &&
+           ((uint32_t)info.base + (uint32_t)info.pages * page_size <= _eeprom.size()) &&
+           !(info.flags & ~PARTITION_FLAGS_MASK) && (info.cache_pages <= AT24CXX_PARTITION_CACHE_LINES) &&
+           (!(info.flags & EEPROM_PART_CRC) || (page_size > 2));
+}
+
+
+EepromPartition::EepromPartition(AT24CXX& eeprom, uint8_t * cache, uint16_t cache_bytes)
+: _eeprom(eeprom)
+, _cache(cache)
+, _cache_bytes(cache ? cache_bytes : 0)
+, _page_size(eeprom.pageSize())
+, _lines(0)
+, _clock(0)
+{
+    memset(&_info, 0, sizeof(_info));
+    invalidate();
+}
+
+bool EepromPartition::open(const EepromPartitionInfo * info)
+{
+    if (!info || !flush())
+        return false;
+
+    if (!info->pages || (info->base % _page_size) ||
+        ((uint32_t)info->base + (uint32_t)info->pages * _page_size > _eeprom.size()) ||
+        ((info->flags & EEPROM_PART_CRC) && (_page_size <= 2)))
+        return false;
+
+    _info  = *info;
+    _lines = (uint8_t)(_cache_bytes / _page_size);
+
+    if (_lines > _info.cache_pages)
+        _lines = _info.cache_pages;
+
+    if (_lines > AT24CXX_PARTITION_CACHE_LINES)
+        _lines = AT24CXX_PARTITION_CACHE_LINES;
+
+    invalidate();
+
+    return true;
+}
+
+bool EepromPartition::format()
+{
+    if (!_info.pages || (_info.flags & EEPROM_PART_READ_ONLY))
+        return false;
+
+    invalidate();
+
+    for (uint16_t page = 0; page < _info.pages; page++)
+    {
+        memset(_scratch, 0xFF, sizeof(_scratch));
+
+        if (!commit(page, _scratch, 0, payload()))
+            return false;
+    }
+
+    return true;
+}
+
+bool EepromPartition::write(uint16_t address, const uint8_t * vals, uint16_t len)
+{
+    uint16_t per_page = payload();
+    uint16_t done     = 0;
+
+    if (!_info.pages || (_info.flags & EEPROM_PART_READ_ONLY) || ((uint32_t)address + len > size()))
+        return false;
+
+    // Plain partitions without a cache need no page buffering
+    if (!_lines && !(_info.flags & EEPROM_PART_CRC))
+        return _eeprom.write((uint16_t)(_info.base + address), (uint8_t*)vals, len);
+
+    while (done < len)
+    {
+        uint16_t  page   = (uint16_t)((address + done) / per_page);
+        uint16_t  offset = (uint16_t)((address + done) % per_page);
+        uint16_t  chunk  = (uint16_t)(((per_page - offset) < (len - done)) ? (per_page - offset) : (len - done));
+        uint8_t * raw;
+        int       line;
+
+        // A page whose whole payload is replaced need not be read first
+        if (!acquire(page, (offset != 0) || (chunk != per_page), raw, line))
+            return false;
+
+        memcpy(&raw[offset], &vals[done], chunk);
+
+        if ((line >= 0) && (_info.flags & EEPROM_PART_WRITE_BACK))
+        {
+            _line_dirty[line] = true;
+        }
+        else if (!commit(page, raw, offset, chunk))
+        {
+            if (line >= 0)
+            {
+                _line_page[line] = PARTITION_NO_PAGE;
+                _line_used[line] = 0;
+            }
+
+            return false;
+        }
+
+        done += chunk;
+    }
+
+    return true;
+}
+
+bool EepromPartition::read(uint16_t address, uint8_t * vals, uint16_t len)
+{
+    uint16_t per_page = payload();
+    uint16_t done     = 0;
+
+    if (!_info.pages || ((uint32_t)address + len > size()))
+        return false;
+
+    if (!_lines && !(_info.flags & EEPROM_PART_CRC))
+        return _eeprom.read((uint16_t)(_info.base + address), vals, len);
+
+    while (done < len)
+    {
+        uint16_t  page   = (uint16_t)((address + done) / per_page);
+        uint16_t  offset = (uint16_t)((address + done) % per_page);
+        uint16_t  chunk  = (uint16_t)(((per_page - offset) < (len - done)) ? (per_page - offset) : (len - done));
+        uint8_t * raw;
+        int       line;
+
+        if (!acquire(page, true, raw, line))
+            return false;
+
+        memcpy(&vals[done], &raw[offset], chunk);
+        done += chunk;
+    }
+
+    return true;
+}
+
+bool EepromPartition::flush()
+{
+    for (uint8_t i = 0; i < _lines; i++)
+    {
+        if (_line_dirty[i])
+        {
+            if (!commit(_line_page[i], &_cache[i * _page_size], 0, payload()))
+                return false;
+
+            _line_dirty[i] = false;
+        }
+    }
+
+    return true;
+}
+
+void EepromPartition::invalidate()
+{
+    for (uint8_t i = 0; i < AT24CXX_PARTITION_CACHE_LINES; i++)
+    {
+        _line_page[i]  = PARTITION_NO_PAGE;
+        _line_dirty[i] = false;
+        _line_used[i]  = 0;
+    }
+}
+
+// Private: Locate a page's buffer, caching it in the least recently used line if a cache is present
+bool EepromPartition::acquire(uint16_t page, bool fill, uint8_t *& raw, int& line)
+{
+    uint16_t crc;
+    bool     corrected;
+
+    line = -1;
+    raw  = _scratch;
+
+    if (_lines)
+    {
+        uint8_t victim = 0;
+
+        for (uint8_t i = 0; i < _lines; i++)
+        {
+            if (_line_page[i] == page)
+            {
+                _line_used[i] = ++_clock;
+                raw           = &_cache[i * _page_size];
+                line          = i;
+                return true;
+            }
+
+            if (_line_used[i] < _line_used[victim])
+                victim = i;
+        }
+
+        if (_line_dirty[victim])
+        {
+            if (!commit(_line_page[victim], &_cache[victim * _page_size], 0, payload()))
+                return false;
+
+            _line_dirty[victim] = false;
+        }
+
+        _line_page[victim] = PARTITION_NO_PAGE;
+        _line_used[victim] = 0;
+        raw                = &_cache[victim * _page_size];
+    }
+
+    if (fill)
+    {
+        if (!_eeprom.read((uint16_t)(_info.base + page * _page_size), raw, _page_size))
+            return false;
+
+        if (_info.flags & EEPROM_PART_CRC)
+        {
+            crc = (uint16_t)(raw[payload()] | (raw[payload() + 1] << 8));
+
+            if (!crc16Correct(raw, payload(), crc, corrected))
+                return false;
+        }
+    }
+
+    if (_lines)
+    {
+        line             = (int)(raw - _cache) / _page_size;
+        _line_page[line] = page;
+        _line_used[line] = ++_clock;
+    }
+
+    return true;
+}
+
+// Private: Write a modified page range to the device, resealing the whole page under CRC
+bool EepromPartition::commit(uint16_t page, uint8_t * raw, uint16_t offset, uint16_t len)
+{
+    uint16_t address = (uint16_t)(_info.base + page * _page_size);
+    uint16_t crc;
+
+    if (!(_info.flags & EEPROM_PART_CRC))
+        return _eeprom.write((uint16_t)(address + offset), &raw[offset], len);
+
+    crc = crc16(raw, payload());
+    raw[payload()]     = (uint8_t)(crc & 0xFF);
+    raw[payload() + 1] = (uint8_t)(crc >> 8);
+
+    return _eeprom.write(address, raw, _page_size);
+}
+
+}
+
+// EOF
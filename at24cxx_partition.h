@@ -0,0 +1,312 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_partition.h
+// Purpose     : AT24CXX EEPROM Partition Table
+// Description :
+//               Named, page-aligned partitions over one AT24CXX device, each accessed through its own handle with
+//               its own policy, so that hot telemetry and cold calibration data need not share one behavior:
+//
+//               - Cache: up to AT24CXX_PARTITION_CACHE_LINES pages held in a caller-provided buffer, evicted in
+//                 least recently used order. Reads of cached pages do not touch the bus.
+//               - Write-back: writes to cached pages are held until flush() or eviction, so repeated updates of
+//                 a page cost one write cycle. Without write-back, or without a cache, writes go straight through.
+//               - CRC: pages are kept in sealed format, i.e. pageSize() - 2 bytes of payload followed by a
+//                 little-endian CRC-16, the format EepromScrubber maintains. Reads verify each page and repair a
+//                 single flipped bit in RAM; a partial page write reads, modifies and reseals the whole page.
+//               - Read-only: writes are refused, e.g. for factory calibration.
+//
+//               Wear leveling is not a partition policy: data needing it should be kept in an EepromRecordRing
+//               or EepromKV placed on the partition's base and pages, which spread wear by their own layout.
+//
+//               A table may be built at runtime with add(), or stored in EEPROM with store() and restored with
+//               load(). Partitions fixed at build time may instead be declared as EepromPartitionSpec types, whose
+//               geometry is checked by static_assert, and accessed through StaticEepromPartition, which owns its
+//               cache and also checks constant offsets at compile time.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_PARTITION_H
+#define _AT24CXX_PARTITION_H
+
+#include <string.h>
+#include "at24cxx.h"
+
+// Largest number of partitions in a table
+#ifndef AT24CXX_PARTITION_MAX
+#define AT24CXX_PARTITION_MAX 8
+#endif
+
+// Largest number of cached pages per partition
+#ifndef AT24CXX_PARTITION_CACHE_LINES
+#define AT24CXX_PARTITION_CACHE_LINES 4
+#endif
+
+// Partition name length, including terminator
+#define AT24CXX_PARTITION_NAME 8
+
+namespace PeripheralIO
+{
+
+// Partition policy flags
+const uint8_t EEPROM_PART_WRITE_BACK = 0x01;
+const uint8_t EEPROM_PART_CRC        = 0x02;
+const uint8_t EEPROM_PART_READ_ONLY  = 0x04;
+
+struct EepromPartitionInfo
+{
+    char     name[AT24CXX_PARTITION_NAME];
+    uint16_t base;         // page-aligned starting address
+    uint16_t pages;        // number of pages
+    uint8_t  flags;        // EEPROM_PART_* policy flags
+    uint8_t  cache_pages;  // pages of cache the handle should be given
+};
+
+class EepromPartitionTable
+{
+    public:
+       /**
+        * @brief Constructor for EepromPartitionTable object
+        * @param eeprom Reference to initialized AT24CXX object
+       */
+        explicit EepromPartitionTable(AT24CXX& eeprom);
+
+        /**
+         * @brief Append a partition
+         * @param name Name of at most AT24CXX_PARTITION_NAME - 1 characters
+         * @param base Page-aligned starting address
+         * @param pages Number of pages
+         * @param flags EEPROM_PART_* policy flags
+         * @param cache_pages Pages of cache, at most AT24CXX_PARTITION_CACHE_LINES
+         * @return False for invalid geometry, overlap, duplicate name or full table; true otherwise
+        */
+        bool add(const char * name, uint16_t base, uint16_t pages, uint8_t flags=0, uint8_t cache_pages=0);
+
+        /**
+         * @brief Store the table in EEPROM under a CRC
+         * @param address Starting address of the stored table, outside every partition
+         * @return False for I2C error, true otherwise
+        */
+        bool store(uint16_t address);
+
+        /**
+         * @brief Replace the table with one stored in EEPROM
+         * @param address Starting address of the stored table
+         * @return False for I2C error or no valid table, true otherwise
+        */
+        bool load(uint16_t address);
+
+        /**
+         * @brief Find a partition by name
+         * @return Pointer to partition info, or null if not present
+        */
+        const EepromPartitionInfo * find(const char * name) const;
+
+        /**
+         * @brief Get number of partitions
+        */
+        uint8_t count() const { return _count; }
+
+        /**
+         * @brief Get bytes occupied by a stored table of the current size
+        */
+        uint16_t storedSize() const;
+
+    private:
+        bool valid(const EepromPartitionInfo& info) const;
+
+        AT24CXX&            _eeprom;
+        EepromPartitionInfo _parts[AT24CXX_PARTITION_MAX];
+        uint8_t             _count;
+};
+
+class EepromPartition
+{
+    public:
+       /**
+        * @brief Constructor for EepromPartition object
+        * @param eeprom Reference to initialized AT24CXX object
+        * @param cache Pointer to cache_pages * pageSize() bytes of caller-owned RAM; null for no cache
+        * @param cache_bytes Size of cache buffer in bytes
+       */
+        EepromPartition(AT24CXX& eeprom, uint8_t * cache=nullptr, uint16_t cache_bytes=0);
+
+        /**
+         * @brief Bind the handle to a partition, flushing any previous one
+         * @param info Pointer to partition info, e.g. from EepromPartitionTable::find()
+         * @return False for null or invalid partition, or I2C error flushing; true otherwise
+        */
+        bool open(const EepromPartitionInfo * info);
+
+        /**
+         * @brief Erase the partition to 0xFF, sealing every page under CRC if so configured; required once before
+         *        first use of a CRC partition
+         * @return False for I2C error, read-only or unbound partition; true otherwise
+        */
+        bool format();
+
+        /**
+         * @brief Write within the partition
+         * @param address Starting address relative to the partition
+         * @param vals Pointer to values to write
+         * @param len Number of bytes to write
+         * @return False for I2C error, uncorrectable page, read-only partition or invalid request; true otherwise
+        */
+        bool write(uint16_t address, const uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Read within the partition
+         * @param address Starting address relative to the partition
+         * @param vals Pointer to array into which read values will be placed
+         * @param len Number of bytes to read
+         * @return False for I2C error, uncorrectable page or invalid request; true otherwise
+        */
+        bool read(uint16_t address, uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Write all pages held by write-back
+         * @return False for I2C error, true otherwise
+        */
+        bool flush();
+
+        /**
+         * @brief Discard cached pages without writing them, e.g. after the region was changed by other means
+        */
+        void invalidate();
+
+        /**
+         * @brief Get usable capacity in bytes, excluding CRC bytes
+        */
+        uint32_t size() const { return (uint32_t)_info.pages * payload(); }
+
+        /**
+         * @brief Get page size of the underlying chip
+        */
+        uint8_t pageSize() const { return (uint8_t)_page_size; }
+
+        /**
+         * @brief Get partition name; empty when unbound
+        */
+        const char * name() const { return _info.name; }
+
+    private:
+        bool     acquire(uint16_t page, bool fill, uint8_t *& raw, int& line);
+        bool     commit(uint16_t page, uint8_t * raw, uint16_t offset, uint16_t len);
+        uint16_t payload() const { return (uint16_t)(_page_size - ((_info.flags & EEPROM_PART_CRC) ? 2 : 0)); }
+
+        AT24CXX&            _eeprom;
+        uint8_t *           _cache;
+        uint16_t            _cache_bytes;
+        uint16_t            _page_size;
+        EepromPartitionInfo _info;
+        uint8_t             _lines;
+        uint16_t            _line_page[AT24CXX_PARTITION_CACHE_LINES];
+        bool                _line_dirty[AT24CXX_PARTITION_CACHE_LINES];
+        uint32_t            _line_used[AT24CXX_PARTITION_CACHE_LINES];
+        uint32_t            _clock;
+        uint8_t             _scratch[AT24CXX_MAX_PAGE_SIZE];
+};
+
+/**
+ * @brief Compile-time partition declaration
+ * @tparam Base Page-aligned starting address
+ * @tparam Pages Number of pages
+ * @tparam PageSize Page size of the target chip
+ * @tparam Flags EEPROM_PART_* policy flags
+ * @tparam CachePages Pages of cache owned by StaticEepromPartition
+*/
+template <uint16_t Base, uint16_t Pages, uint8_t PageSize, uint8_t Flags=0, uint8_t CachePages=0>
+struct EepromPartitionSpec
+{
+    static_assert(PageSize && (PageSize <= AT24CXX_MAX_PAGE_SIZE), "invalid page size");
+    static_assert(0 == (Base % PageSize), "partition base must be page aligned");
+    static_assert(Pages > 0, "partition must hold at least one page");
+    static_assert((uint32_t)Base + (uint32_t)Pages * PageSize <= 0x10000, "partition exceeds address space");
+    static_assert(CachePages <= AT24CXX_PARTITION_CACHE_LINES, "cache exceeds AT24CXX_PARTITION_CACHE_LINES");
+    static_assert(!(Flags & EEPROM_PART_CRC) || (PageSize > 2), "page too small for CRC");
+
+    static const uint16_t BASE        = Base;
+    static const uint16_t PAGES       = Pages;
+    static const uint8_t  PAGE_SIZE   = PageSize;
+    static const uint8_t  FLAGS       = Flags;
+    static const uint8_t  CACHE_PAGES = CachePages;
+    static const uint32_t END         = (uint32_t)Base + (uint32_t)Pages * PageSize;
+    static const uint32_t SIZE        = (uint32_t)Pages * (PageSize - ((Flags & EEPROM_PART_CRC) ? 2 : 0));
+};
+
+/**
+ * @brief Check at compile time that two partition specs do not overlap
+*/
+template <typename A, typename B>
+constexpr bool eepromPartitionsDisjoint()
+{
+    return (A::END <= B::BASE) || (B::END <= A::BASE);
+}
+
+template <typename Spec>
+class StaticEepromPartition : public EepromPartition
+{
+    public:
+       /**
+        * @brief Constructor for StaticEepromPartition object
+        * @param eeprom Reference to initialized AT24CXX object
+       */
+        explicit StaticEepromPartition(AT24CXX& eeprom)
+        : EepromPartition(eeprom, Spec::CACHE_PAGES ? _lines : nullptr, sizeof(_lines))
+        { }
+
+        /**
+         * @brief Bind the handle to its declared partition
+         * @return False if the chip's page size or capacity does not match the declaration, true otherwise
+        */
+        bool open()
+        {
+            EepromPartitionInfo info;
+
+            if (pageSize() != Spec::PAGE_SIZE)
+                return false;
+
+            memset(&info, 0, sizeof(info));
+            info.base        = Spec::BASE;
+            info.pages       = Spec::PAGES;
+            info.flags       = Spec::FLAGS;
+            info.cache_pages = Spec::CACHE_PAGES;
+
+            return EepromPartition::open(&info);
+        }
+
+        /**
+         * @brief Write at a constant offset, bounds checked at compile time
+        */
+        template <uint16_t Address, uint16_t Len>
+        bool write(const uint8_t * vals)
+        {
+            static_assert((uint32_t)Address + Len <= Spec::SIZE, "write exceeds partition");
+            return EepromPartition::write(Address, vals, Len);
+        }
+
+        /**
+         * @brief Read at a constant offset, bounds checked at compile time
+        */
+        template <uint16_t Address, uint16_t Len>
+        bool read(uint8_t * vals)
+        {
+            static_assert((uint32_t)Address + Len <= Spec::SIZE, "read exceeds partition");
+            return EepromPartition::read(Address, vals, Len);
+        }
+
+        using EepromPartition::write;
+        using EepromPartition::read;
+
+    private:
+        uint8_t _lines[(Spec::CACHE_PAGES ? Spec::CACHE_PAGES : 1) * Spec::PAGE_SIZE];
+};
+
+}
+
+#endif // _AT24CXX_PARTITION_H
+
+// EOF
@@ -0,0 +1,174 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_persistent.cpp
+// Purpose     : AT24CXX EEPROM Persistent Variables
+// Description : This source file implements header file at24cxx_persistent.h.
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <string.h>
+#include "at24cxx_persistent.h"
+
+namespace PeripheralIO
+{
+
+PersistentGroup::PersistentGroup(AT24CXX& eeprom)
+: _eeprom(eeprom)
+, _head(nullptr)
+{ }
+
+bool PersistentGroup::flush()
+{
+    uint8_t  page[AT24CXX_MAX_PAGE_SIZE];
+    uint16_t page_size = _eeprom.pageSize();
+    uint32_t pos       = 0;
+
+    for (;;)
+    {
+        PersistentBase * first = _head;
+        uint32_t         lo;
+        uint32_t         hi;
+        uint32_t         page_end;
+        bool             gaps = false;
+
+        // First dirty variable with bytes not yet committed in this pass
+        while (first && (!first->_dirty || ((uint32_t)first->_address + first->_size <= pos)))
+            first = first->_next;
+
+        if (!first)
+            break;
+
+        lo       = (first->_address > pos) ? first->_address : pos;
+        hi       = lo;
+        page_end = (lo / page_size + 1) * page_size;
+
+        for (PersistentBase * var = first; var && (var->_address < page_end); var = var->_next)
+        {
+            uint32_t end = (uint32_t)var->_address + var->_size;
+
+            if (!var->_dirty)
+                continue;
+
+            if (var->_address > hi)
+                gaps = true;
+
+            hi = (end < page_end) ? end : page_end;
+        }
+
+        // Bytes between dirty variables are preserved by reading them back
+        if (gaps && !_eeprom.read((uint16_t)lo, page, (uint16_t)(hi - lo)))
+            return false;
+
+        for (PersistentBase * var = first; var && (var->_address < hi); var = var->_next)
+        {
+            uint32_t start = (var->_address > lo) ? var->_address : lo;
+            uint32_t end   = ((uint32_t)var->_address + var->_size < hi) ? (uint32_t)var->_address + var->_size : hi;
+
+            if (var->_dirty && (start < end))
+                memcpy(&page[start - lo], &var->_bytes[start - var->_address], end - start);
+        }
+
+        if (!_eeprom.write((uint16_t)lo, page, (uint16_t)(hi - lo)))
+            return false;
+
+        for (PersistentBase * var = first; var && (var->_address < hi); var = var->_next)
+        {
+            if ((uint32_t)var->_address + var->_size <= hi)
+                var->_dirty = false;
+        }
+
+        pos = hi;
+    }
+
+    return true;
+}
+
+uint16_t PersistentGroup::pending() const
+{
+    uint16_t count = 0;
+
+    for (PersistentBase * var = _head; var; var = var->_next)
+    {
+        if (var->_dirty)
+            count++;
+    }
+
+    return count;
+}
+
+void PersistentGroup::invalidate()
+{
+    for (PersistentBase * var = _head; var; var = var->_next)
+    {
+        var->_loaded = false;
+        var->_dirty  = false;
+    }
+}
+
+// Private: Insert variable in address order
+void PersistentGroup::link(PersistentBase * var)
+{
+    PersistentBase ** link = &_head;
+
+    while (*link && ((*link)->_address < var->_address))
+        link = &(*link)->_next;
+
+    var->_next = *link;
+    *link      = var;
+}
+
+// Private: Remove variable from the list
+void PersistentGroup::unlink(PersistentBase * var)
+{
+    PersistentBase ** link = &_head;
+
+    while (*link && (*link != var))
+        link = &(*link)->_next;
+
+    if (*link)
+        *link = var->_next;
+}
+
+
+PersistentBase::PersistentBase(PersistentGroup& group, uint16_t address, uint16_t size, uint8_t * bytes)
+: _group(group)
+, _address(address)
+, _size(size)
+, _bytes(bytes)
+, _loaded(false)
+, _dirty(false)
+, _next(nullptr)
+{
+    _group.link(this);
+}
+
+PersistentBase::~PersistentBase()
+{
+    _group.unlink(this);
+}
+
+// Protected: Read value from EEPROM on first access
+bool PersistentBase::load()
+{
+    if (!_loaded)
+        _loaded = _group._eeprom.read(_address, _bytes, _size);
+
+    return _loaded;
+}
+
+// Protected: Replace value, marking it dirty only if its bytes change; a full assignment needs no load
+void PersistentBase::assign(const uint8_t * bytes)
+{
+    if (_loaded && (0 == memcmp(_bytes, bytes, _size)))
+        return;
+
+    memcpy(_bytes, bytes, _size);
+    _loaded = true;
+    _dirty  = true;
+}
+
+}
+
+// EOF
@@ -0,0 +1,156 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_persistent.h
+// Purpose     : AT24CXX EEPROM Persistent Variables
+// Description :
+//               Persistent<T> binds a RAM copy of a trivially copyable value to a fixed EEPROM address. The value is
+//               read lazily on first access, so unused variables cost no bus time at boot. Assignment marks the
+//               variable dirty only when its bytes actually change, and nothing is written until its group is
+//               flushed.
+//
+//               Each variable registers with a PersistentGroup, which keeps its members in an address-ordered
+//               intrusive list. flush() walks that list and commits the dirty variables page by page: all dirty
+//               bytes falling within one page are combined into a single write, so ten variables updated in one
+//               page cost one write cycle instead of ten. Gaps between them within the page are read back first
+//               so that bytes not held by dirty variables are preserved. A variable straddling a page boundary is
+//               written in one part per page.
+//
+//               Variables of a group must not overlap. A variable going out of scope leaves its group, discarding
+//               any uncommitted change.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_PERSISTENT_H
+#define _AT24CXX_PERSISTENT_H
+
+#include <string.h>
+#include "at24cxx.h"
+
+namespace PeripheralIO
+{
+
+class PersistentBase;
+
+class PersistentGroup
+{
+    public:
+       /**
+        * @brief Constructor for PersistentGroup object
+        * @param eeprom Reference to initialized AT24CXX object
+       */
+        explicit PersistentGroup(AT24CXX& eeprom);
+
+        /**
+         * @brief Commit all dirty variables in page-ordered writes, one per page touched
+         * @return False for I2C error, true otherwise; variables not yet committed remain dirty
+        */
+        bool flush();
+
+        /**
+         * @brief Get number of dirty variables
+        */
+        uint16_t pending() const;
+
+        /**
+         * @brief Discard RAM copies, including uncommitted changes, so that each variable is reloaded on next access
+        */
+        void invalidate();
+
+    private:
+        friend class PersistentBase;
+
+        void link(PersistentBase * var);
+        void unlink(PersistentBase * var);
+
+        AT24CXX&         _eeprom;
+        PersistentBase * _head;
+};
+
+class PersistentBase
+{
+    public:
+        PersistentBase(const PersistentBase&) = delete;
+        PersistentBase& operator=(const PersistentBase&) = delete;
+
+        /**
+         * @brief Check whether the variable holds an uncommitted change
+        */
+        bool dirty() const { return _dirty; }
+
+        /**
+         * @brief Check whether the RAM copy is valid, i.e. loaded or assigned
+        */
+        bool loaded() const { return _loaded; }
+
+        /**
+         * @brief Get EEPROM address of the variable
+        */
+        uint16_t address() const { return _address; }
+
+    protected:
+        PersistentBase(PersistentGroup& group, uint16_t address, uint16_t size, uint8_t * bytes);
+        ~PersistentBase();
+
+        bool load();
+        void assign(const uint8_t * bytes);
+
+    private:
+        friend class PersistentGroup;
+
+        PersistentGroup& _group;
+        uint16_t         _address;
+        uint16_t         _size;
+        uint8_t *        _bytes;
+        bool             _loaded;
+        bool             _dirty;
+        PersistentBase * _next;
+};
+
+template <typename T>
+class Persistent : public PersistentBase
+{
+    public:
+       /**
+        * @brief Constructor for Persistent object
+        * @param group Group through which the variable is committed
+        * @param address EEPROM address of the value
+       */
+        Persistent(PersistentGroup& group, uint16_t address)
+        : PersistentBase(group, address, (uint16_t)sizeof(T), (uint8_t*)&_value)
+        { }
+
+        /**
+         * @brief Get value, loading it on first access; a failed load is retried on the next access
+        */
+        const T& get()
+        {
+            load();
+            return _value;
+        }
+
+        /**
+         * @brief Set value, marking the variable dirty if its bytes change
+        */
+        void set(const T& value) { assign((const uint8_t*)&value); }
+
+        operator const T&() { return get(); }
+
+        Persistent& operator=(const T& value)
+        {
+            set(value);
+            return *this;
+        }
+
+    private:
+        T _value;
+};
+
+}
+
+#endif // _AT24CXX_PERSISTENT_H
+
+// EOF
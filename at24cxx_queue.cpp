@@ -0,0 +1,287 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_queue.cpp
+// Purpose     : AT24CXX EEPROM Write Queue
+// Description : This source file implements header file at24cxx_queue.h.
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <string.h>
+#include "at24cxx_queue.h"
+
+namespace PeripheralIO
+{
+
+EepromQueue::EepromQueue(AT24CXX& eeprom)
+: _eeprom(eeprom)
+, _count(0)
+, _bypassed(0)
+, _epoch(0)
+, _reads(0)
+, _reads_tail(0)
+{
+    for (uint8_t i = 0; i < AT24CXX_QUEUE_DEPTH; i++)
+        _order[i] = i;
+}
+
+bool EepromQueue::write(uint16_t address, const uint8_t * vals, uint16_t len)
+{
+    uint16_t done = 0;
+    uint8_t  chunk;
+
+    if ((uint32_t)(address + len) > _eeprom.size())
+        return false;
+
+    while (done < len)
+    {
+        chunk = (uint8_t)(_eeprom.pageSize() - ((address + done) % _eeprom.pageSize()));
+
+        if (chunk > (len - done))
+            chunk = (uint8_t)(len - done);
+
+        if (!enqueue((uint16_t)(address + done), &vals[done], chunk))
+            return false;
+
+        done += chunk;
+    }
+
+    return true;
+}
+
+void EepromQueue::fence()
+{
+    // Consecutive fences are one fence, so pending epochs never outnumber slots and the counter cannot wrap onto one
+    if (_count && (_slots[_order[_count - 1]].epoch == _epoch))
+        _epoch++;
+}
+
+bool EepromQueue::read(uint16_t address, uint8_t * vals, uint16_t len)
+{
+    if ((uint32_t)(address + len) > _eeprom.size())
+        return false;
+
+    if (!covered(address, len) && !_eeprom.read(address, vals, len))
+        return false;
+
+    overlay(address, vals, len);
+
+    return true;
+}
+
+bool EepromQueue::submitRead(EepromReadRequest& request)
+{
+    if ((uint32_t)(request.address + request.len) > _eeprom.size())
+        return false;
+
+    request.next = 0;
+
+    if (covered(request.address, request.len))
+    {
+        overlay(request.address, request.vals, request.len);
+        request.status = EEPROM_READ_DONE;
+        return true;
+    }
+
+    request.status = EEPROM_READ_PENDING;
+
+    if (_reads_tail)
+        _reads_tail->next = &request;
+    else
+        _reads = &request;
+
+    _reads_tail = &request;
+
+    return true;
+}
+
+bool EepromQueue::poll()
+{
+    bool wrote;
+
+    if ((!_count && !_reads) || _eeprom.busy())
+        return true;
+
+    return service(wrote);
+}
+
+bool EepromQueue::flush()
+{
+    bool result = true;
+    bool wrote;
+
+    while (_count || _reads)
+    {
+        // A failed read is completed as failed and the flush continues; a failed write stops it
+        if (!service(wrote))
+        {
+            result = false;
+
+            if (wrote)
+                break;
+        }
+    }
+
+    return result;
+}
+
+// Private: Add one page-bounded write, resolving hazards with pending writes
+bool EepromQueue::enqueue(uint16_t address, const uint8_t * vals, uint8_t len)
+{
+    uint16_t end = (uint16_t)(address + len);
+    uint8_t  pos;
+
+    // Earlier writes since the last fence wholly rewritten by this one need never reach the device
+    for (pos = 0; pos < _count; )
+    {
+        const Slot& s = _slots[_order[pos]];
+
+        if ((s.epoch == _epoch) && (s.address >= address) && ((uint16_t)(s.address + s.len) <= end))
+            remove(pos);
+        else
+            pos++;
+    }
+
+    // Merge into the newest write it overlaps or adjoins within the page; a newer overlapping write or a fence
+    // ends the search
+    for (pos = _count; pos > 0; pos--)
+    {
+        Slot&    s     = _slots[_order[pos - 1]];
+        uint16_t s_end = (uint16_t)(s.address + s.len);
+        uint16_t lo;
+        uint16_t hi;
+
+        if (s.epoch != _epoch)
+            break;
+
+        if ((address > s_end) || (end < s.address))
+            continue;
+
+        if ((address / _eeprom.pageSize()) != (s.address / _eeprom.pageSize()))
+            continue;
+
+        lo = (address < s.address) ? address : s.address;
+        hi = (end > s_end) ? end : s_end;
+
+        memmove(&s.data[s.address - lo], s.data, s.len);
+        memcpy(&s.data[address - lo], vals, len);
+
+        s.address = lo;
+        s.len     = (uint8_t)(hi - lo);
+
+        return true;
+    }
+
+    if ((AT24CXX_QUEUE_DEPTH == _count) && !commitOldest())
+        return false;
+
+    Slot& slot = _slots[_order[_count++]];
+
+    slot.address = address;
+    slot.len     = len;
+    slot.epoch   = _epoch;
+    memcpy(slot.data, vals, len);
+
+    return true;
+}
+
+// Private: Perform oldest read, unless the oldest write has waited long enough, else commit oldest write
+bool EepromQueue::service(bool& wrote)
+{
+    EepromReadRequest* request = _reads;
+    bool               ok;
+
+    wrote = !request || (_count && (_bypassed >= AT24CXX_QUEUE_MAX_BYPASS));
+
+    if (wrote)
+    {
+        // A failing write yields to reads again rather than blocking them
+        ok        = commitOldest();
+        _bypassed = 0;
+        return ok;
+    }
+
+    _reads = request->next;
+
+    if (!_reads)
+        _reads_tail = 0;
+
+    if (_count)
+        _bypassed++;
+
+    // Overlaying at completion observes every write submitted so far
+    ok = _eeprom.read(request->address, request->vals, request->len);
+
+    if (ok)
+        overlay(request->address, request->vals, request->len);
+
+    request->status = ok ? EEPROM_READ_DONE : EEPROM_READ_FAILED;
+
+    return ok;
+}
+
+// Private: Check whether every byte of a range is held by pending writes
+bool EepromQueue::covered(uint16_t address, uint16_t len) const
+{
+    bool     hit = true;
+    uint32_t end = (uint32_t)address + len;
+
+    for (uint32_t a = address; hit && (a < end); a++)
+    {
+        hit = false;
+
+        for (uint8_t i = 0; !hit && (i < _count); i++)
+        {
+            const Slot& s = _slots[_order[i]];
+            hit           = (a >= s.address) && (a < (uint32_t)(s.address + s.len));
+        }
+    }
+
+    return hit;
+}
+
+// Private: Lay pending writes over data read from the device, oldest first so the newest prevails
+void EepromQueue::overlay(uint16_t address, uint8_t * vals, uint16_t len) const
+{
+    uint32_t end = (uint32_t)address + len;
+
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        const Slot& s  = _slots[_order[i]];
+        uint32_t    lo = (s.address > address) ? s.address : address;
+        uint32_t    hi = ((uint32_t)(s.address + s.len) < end) ? (uint32_t)(s.address + s.len) : end;
+
+        if (lo < hi)
+            memcpy(&vals[lo - address], &s.data[lo - s.address], hi - lo);
+    }
+}
+
+// Private: Write oldest slot to the device, keeping it queued on failure
+bool EepromQueue::commitOldest()
+{
+    Slot& s = _slots[_order[0]];
+
+    if (!_eeprom.write(s.address, s.data, s.len))
+        return false;
+
+    remove(0);
+    _bypassed = 0;
+
+    return true;
+}
+
+// Private: Drop slot at queue position, recycling its index
+void EepromQueue::remove(uint8_t pos)
+{
+    uint8_t index = _order[pos];
+
+    for (uint8_t i = pos; (i + 1) < _count; i++)
+        _order[i] = _order[i + 1];
+
+    _order[--_count] = index;
+}
+
+}
+
+// EOF
@@ -0,0 +1,170 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_queue.h
+// Purpose     : AT24CXX EEPROM Write Queue
+// Description :
+//               Asynchronous write front end for AT24CXX. write() copies data into page-bounded RAM slots and
+//               returns at once; poll(), called from the application's main loop, commits the oldest slot with one
+//               page write whenever the device is idle. A full queue commits its oldest slot before accepting more.
+//
+//               Hazards between pending writes are resolved in RAM before they reach the bus:
+//
+//               - Write-after-write: a write fully covering an earlier pending write cancels it.
+//               - Partial overlap: a write overlapping or adjoining a pending write to the same page is merged into
+//                 it, provided no later pending write overlaps the new data, so that the final contents are those
+//                 of program order.
+//               - Read-after-write: read() overlays pending writes on the device contents, and does not touch the
+//                 bus at all when every requested byte is pending.
+//
+//               Repeated rewrites of status bytes thereby collapse into a single page write per poll interval.
+//
+//               Reads may also be submitted asynchronously with submitRead(). Queued reads take priority over
+//               queued writes: each poll() with the device idle performs the oldest read before any write, so a
+//               read waits for at most the write cycle in progress rather than for a backlog of page writes. To
+//               keep writes from starving, once AT24CXX_QUEUE_MAX_BYPASS reads have overtaken the oldest pending
+//               write, that write is committed first. A queued read observes every write submitted before it
+//               completes; reads wholly covered by pending writes complete on submission.
+//
+//               fence() orders writes for crash consistency, e.g. data before its commit marker. Writes are
+//               committed oldest first, and cancellation and merging only combine writes between the same pair of
+//               fences, so no write is ever committed ahead of a write issued before an intervening fence.
+//               poll() only avoids blocking when the driver is built with AT24CXX_DEFERRED_WRITE_CYCLE, whereupon it
+//               returns without action while the device is programming; otherwise each commit blocks for the write
+//               cycle.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_QUEUE_H
+#define _AT24CXX_QUEUE_H
+
+#include "at24cxx.h"
+
+// Number of page-bounded write slots; each holds AT24CXX_MAX_PAGE_SIZE bytes of data
+#ifndef AT24CXX_QUEUE_DEPTH
+#define AT24CXX_QUEUE_DEPTH 8
+#endif
+
+// Number of queued reads allowed to overtake the oldest pending write before it is committed
+#ifndef AT24CXX_QUEUE_MAX_BYPASS
+#define AT24CXX_QUEUE_MAX_BYPASS 4
+#endif
+
+namespace PeripheralIO
+{
+
+enum EepromReadStatus
+{
+    EEPROM_READ_PENDING = 0,
+    EEPROM_READ_DONE    = 1,
+    EEPROM_READ_FAILED  = 2
+};
+
+// Caller-owned asynchronous read; must remain valid until status leaves EEPROM_READ_PENDING
+struct EepromReadRequest
+{
+    uint16_t            address;
+    uint16_t            len;
+    uint8_t *           vals;
+    volatile uint8_t    status; // EepromReadStatus
+    EepromReadRequest * next;
+};
+
+class EepromQueue
+{
+    public:
+       /**
+        * @brief Constructor for EepromQueue object
+        * @param eeprom Reference to initialized AT24CXX object
+       */
+        explicit EepromQueue(AT24CXX& eeprom);
+
+        /**
+         * @brief Queue write, committing the oldest pending writes first if the queue is full
+         * @param address Starting address to which values should be written
+         * @param vals Pointer to values; copied before return
+         * @param len Number of bytes to write
+         * @return False for I2C error committing a pending write or invalid request, true otherwise
+        */
+        bool write(uint16_t address, const uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Order writes: every write queued before the fence completes its write cycle before any write
+         *        queued after it begins
+        */
+        void fence();
+
+        /**
+         * @brief Read, observing all queued writes
+         * @param address Address from which values should be read
+         * @param vals Pointer to array into which read values will be placed
+         * @param len Number of bytes to read
+         * @return False for I2C error or invalid request, true otherwise
+        */
+        bool read(uint16_t address, uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Queue read ahead of pending writes; completes at once if every byte is pending
+         * @param request Read to perform; address, len and vals must be set
+         * @return False for invalid request, true otherwise
+        */
+        bool submitRead(EepromReadRequest& request);
+
+        /**
+         * @brief Perform the oldest queued read, or commit the oldest pending write, if the device is idle;
+         *        call regularly
+         * @return False for I2C error, in which case a write remains queued and a read is marked failed;
+         *         true otherwise
+        */
+        bool poll();
+
+        /**
+         * @brief Complete all queued reads and commit all pending writes, blocking through their write cycles
+         * @return False for I2C error, true otherwise
+        */
+        bool flush();
+
+        /**
+         * @brief Get number of pending page writes
+        */
+        uint8_t pending() const { return _count; }
+
+        /**
+         * @brief Check whether any queued read is still pending
+        */
+        bool readsPending() const { return (0 != _reads); }
+
+    private:
+        struct Slot
+        {
+            uint16_t address;
+            uint8_t  len;
+            uint8_t  epoch; // fence interval
+            uint8_t  data[AT24CXX_MAX_PAGE_SIZE];
+        };
+
+        bool enqueue(uint16_t address, const uint8_t * vals, uint8_t len);
+        bool commitOldest();
+        bool service(bool& wrote);
+        bool covered(uint16_t address, uint16_t len) const;
+        void overlay(uint16_t address, uint8_t * vals, uint16_t len) const;
+        void remove(uint8_t pos);
+
+        AT24CXX&           _eeprom;
+        Slot               _slots[AT24CXX_QUEUE_DEPTH];
+        uint8_t            _order[AT24CXX_QUEUE_DEPTH]; // slot indices, oldest first
+        uint8_t            _count;
+        uint8_t            _bypassed;                   // reads performed while a write waited
+        uint8_t            _epoch;
+        EepromReadRequest* _reads;
+        EepromReadRequest* _reads_tail;
+};
+
+}
+
+#endif // _AT24CXX_QUEUE_H
+
+// EOF
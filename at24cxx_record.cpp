@@ -0,0 +1,305 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_record.cpp
+// Purpose     : AT24CXX EEPROM Schema-Versioned Records
+// Description : This source file implements header file at24cxx_record.h.
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <string.h>
+#include "at24cxx_record.h"
+#include "at24cxx_crc.h"
+
+namespace PeripheralIO
+{
+
+// Record Header Defines
+const uint8_t EEPROM_RECORD_MARKER = 0xA5;
+
+// Private: CRC over version, sequence and length, to be continued over the payload
+static uint16_t recordCrcStart(uint8_t version, uint8_t sequence, uint16_t len)
+{
+    uint8_t prefix[4];
+
+    prefix[0] = version;
+    prefix[1] = sequence;
+    prefix[2] = (uint8_t)(len & 0xFF);
+    prefix[3] = (uint8_t)(len >> 8);
+
+    return crc16(prefix, sizeof(prefix));
+}
+
+
+EepromRecord::EepromRecord(AT24CXX& eeprom, uint16_t address, uint16_t capacity, uint8_t version,
+                           const EepromMigrationFn * migrations)
+: _eeprom(eeprom)
+, _migrations(migrations)
+, _address(address)
+, _capacity(capacity)
+, _version(version)
+, _sequence(0)
+, _active(-1)
+, _located(false)
+, _current(false)
+{ }
+
+bool EepromRecord::load(uint8_t * vals, uint16_t& len)
+{
+    uint8_t version;
+
+    if (!readPayload(vals, version, len))
+        return false;
+
+    if (version != _version)
+        return upgrade(vals, version, len);
+
+    _current = true;
+    return true;
+}
+
+bool EepromRecord::store(const uint8_t * vals, uint16_t len)
+{
+    uint8_t  page[AT24CXX_MAX_PAGE_SIZE];
+    uint8_t  header[AT24CXX_RECORD_HEADER];
+    uint8_t  slot;
+    uint8_t  sequence;
+    uint16_t base;
+    uint16_t crc;
+    uint16_t total;
+    uint16_t pos = 0;
+    uint16_t page_size = _eeprom.pageSize();
+    uint16_t chunk;
+
+    if (len > _capacity)
+        return false;
+
+    // The active slot must be known, or the write could land on the only valid copy
+    if (!_located && !locate())
+        return false;
+
+    slot      = (0 == _active) ? 1 : 0;
+    sequence  = (uint8_t)(_sequence + 1);
+    base      = slotAddress(slot);
+    crc       = crc16Update(recordCrcStart(_version, sequence, len), vals, len);
+    header[0] = _version;
+    header[1] = EEPROM_RECORD_MARKER;
+    header[2] = sequence;
+    header[3] = (uint8_t)(len & 0xFF);
+    header[4] = (uint8_t)(len >> 8);
+    header[5] = (uint8_t)(crc & 0xFF);
+    header[6] = (uint8_t)(crc >> 8);
+    total     = AT24CXX_RECORD_HEADER + len;
+
+    // Header and payload are assembled per page so that each page costs a single write cycle
+    while (pos < total)
+    {
+        chunk = page_size - ((base + pos) % page_size);
+
+        if (chunk > (total - pos))
+            chunk = total - pos;
+
+        for (uint16_t i = 0; i < chunk; i++)
+        {
+            uint16_t at = pos + i;
+            page[i] = (at < AT24CXX_RECORD_HEADER) ? header[at] : vals[at - AT24CXX_RECORD_HEADER];
+        }
+
+        // A failed write leaves the active slot untouched
+        if (!_eeprom.write((uint16_t)(base + pos), page, chunk))
+            return false;
+
+        pos += chunk;
+    }
+
+    _active   = (int8_t)slot;
+    _sequence = sequence;
+    _current  = true;
+
+    return true;
+}
+
+bool EepromRecord::migrate(uint8_t * scratch)
+{
+    uint8_t  version;
+    uint16_t len;
+
+    if (_current)
+        return true;
+
+    if (!readPayload(scratch, version, len))
+        return false;
+
+    if (version != _version)
+        return upgrade(scratch, version, len);
+
+    _current = true;
+    return true;
+}
+
+// Private: Validate both slots and select the one holding the record
+bool EepromRecord::locate()
+{
+    bool    valid_a;
+    bool    valid_b;
+    uint8_t sequence_a = 0;
+    uint8_t sequence_b = 0;
+
+    _located = false;
+
+    if (!checkSlot(0, valid_a, sequence_a) || !checkSlot(1, valid_b, sequence_b))
+        return false;
+
+    // Newer valid slot wins; the sequence comparison tolerates wrap
+    if (valid_b && (!valid_a || ((int8_t)(sequence_b - sequence_a) > 0)))
+    {
+        _active   = 1;
+        _sequence = sequence_b;
+    }
+    else if (valid_a)
+    {
+        _active   = 0;
+        _sequence = sequence_a;
+    }
+    else
+    {
+        _active   = -1;
+        _sequence = 0;
+    }
+
+    _located = true;
+    return true;
+}
+
+// Private: Verify header and payload CRC of a slot without buffering the payload
+bool EepromRecord::checkSlot(uint8_t slot, bool& valid, uint8_t& sequence)
+{
+    uint8_t  header[AT24CXX_RECORD_HEADER];
+    uint8_t  chunk[16];
+    uint16_t addr = slotAddress(slot);
+    uint16_t len;
+    uint16_t crc;
+    uint16_t remaining;
+    uint8_t  n;
+
+    valid = false;
+
+    if (!_eeprom.read(addr, header, AT24CXX_RECORD_HEADER))
+        return false;
+
+    len = (uint16_t)(header[3] | (header[4] << 8));
+
+    if ((EEPROM_RECORD_MARKER != header[1]) || (len > _capacity))
+        return true;
+
+    crc       = recordCrcStart(header[0], header[2], len);
+    addr     += AT24CXX_RECORD_HEADER;
+    remaining = len;
+
+    while (remaining)
+    {
+        n = (remaining < sizeof(chunk)) ? (uint8_t)remaining : (uint8_t)sizeof(chunk);
+
+        if (!_eeprom.read(addr, chunk, n))
+            return false;
+
+        crc        = crc16Update(crc, chunk, n);
+        addr      += n;
+        remaining -= n;
+    }
+
+    valid    = (crc == (uint16_t)(header[5] | (header[6] << 8)));
+    sequence = header[2];
+
+    return true;
+}
+
+// Private: Read and validate header and payload of the active slot
+bool EepromRecord::readPayload(uint8_t * vals, uint8_t& version, uint16_t& len)
+{
+    uint8_t  header[AT24CXX_RECORD_HEADER];
+    uint16_t crc;
+
+    // Slots are located on every load, so that the result reflects the device
+    if (!locate() || (_active < 0))
+        return false;
+
+    if (!_eeprom.read(slotAddress((uint8_t)_active), header, AT24CXX_RECORD_HEADER))
+        return false;
+
+    version = header[0];
+    len     = (uint16_t)(header[3] | (header[4] << 8));
+    crc     = (uint16_t)(header[5] | (header[6] << 8));
+
+    if (len > _capacity)
+        return false;
+
+    if (len && !_eeprom.read((uint16_t)(slotAddress((uint8_t)_active) + AT24CXX_RECORD_HEADER), vals, len))
+        return false;
+
+    return (crc16Update(recordCrcStart(version, header[2], len), vals, len) == crc);
+}
+
+// Private: Apply migration steps in RAM and write the result back at current version
+bool EepromRecord::upgrade(uint8_t * vals, uint8_t version, uint16_t& len)
+{
+    if (version > _version)
+        return false;
+
+    for (; version < _version; version++)
+    {
+        if (!_migrations || !_migrations[version] || !_migrations[version](vals, len, _capacity))
+            return false;
+
+        if (len > _capacity)
+            return false;
+    }
+
+    // Written to the inactive slot, so the record at its old version survives an interrupted write-back
+    return store(vals, len);
+}
+
+// Private: Address of slot A (0) or B (1)
+uint16_t EepromRecord::slotAddress(uint8_t slot) const
+{
+    return (uint16_t)(_address + slot * (AT24CXX_RECORD_HEADER + _capacity));
+}
+
+
+EepromRecordSet::EepromRecordSet(uint8_t * scratch, uint16_t scratch_len)
+: _scratch(scratch)
+, _scratch_len(scratch_len)
+, _count(0)
+, _next(0)
+{ }
+
+bool EepromRecordSet::add(EepromRecord& record)
+{
+    if ((_count >= AT24CXX_RECORD_SET_SIZE) || (record.capacity() > _scratch_len))
+        return false;
+
+    _records[_count++] = &record;
+    return true;
+}
+
+bool EepromRecordSet::migrateNext()
+{
+    // Failed records stay not current for rewind(); absent or corrupt ones are rewritten by their next store()
+    while (_next < _count)
+    {
+        EepromRecord* record = _records[_next++];
+
+        if (!record->isCurrent())
+        {
+            record->migrate(_scratch);
+            break;
+        }
+    }
+
+    return (_next < _count);
+}
+
+}
+
+// EOF
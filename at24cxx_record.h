@@ -0,0 +1,172 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_record.h
+// Purpose     : AT24CXX EEPROM Schema-Versioned Records
+// Description :
+//               Persistent records stamped with a schema version, payload length and CRC. When firmware changes a
+//               record's layout, it registers one migration function per version step instead of converting all
+//               data at boot; a record found at an older version is converted in RAM on its first load() and
+//               written back, so the migration cost is paid lazily and write cycles are spread over time.
+//               EepromRecordSet may additionally migrate registered records one per call from an idle loop.
+//
+//               Each record occupies two fixed slots, A and B, of header plus capacity bytes; migrations must not
+//               grow the payload beyond the slot capacity. The header carries a sequence number, and the valid
+//               slot with the newer sequence holds the record. store() and the write-back of a migration always
+//               write the other slot under the next sequence, so the previous contents stay intact until the new
+//               slot is complete, and a reset part way through falls back to them on the next load(). Records at
+//               a version newer than the firmware are rejected.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_RECORD_H
+#define _AT24CXX_RECORD_H
+
+#include "at24cxx.h"
+
+// Maximum number of records tracked by an EepromRecordSet
+#ifndef AT24CXX_RECORD_SET_SIZE
+#define AT24CXX_RECORD_SET_SIZE 8
+#endif
+
+namespace PeripheralIO
+{
+
+// Size of the record header preceding the payload in each slot
+const uint8_t AT24CXX_RECORD_HEADER = 7;
+
+/**
+ * @brief Migration step converting a payload in place from version N to N + 1
+ * @param data Payload buffer of at least capacity bytes
+ * @param len In: payload length at version N; out: payload length at version N + 1
+ * @param capacity Slot capacity bounding the migrated length
+ * @return False if payload cannot be migrated, true otherwise
+*/
+typedef bool (*EepromMigrationFn)(uint8_t * data, uint16_t& len, uint16_t capacity);
+
+class EepromRecord
+{
+    public:
+       /**
+        * @brief Constructor for EepromRecord object
+        * @param eeprom Reference to initialized AT24CXX object
+        * @param address Starting address of the record's slots
+        * @param capacity Maximum payload size in bytes; the record occupies 2 * (AT24CXX_RECORD_HEADER + capacity)
+        * @param version Current schema version of the payload
+        * @param migrations Array of version entries; migrations[N] converts version N to N + 1
+       */
+        EepromRecord(AT24CXX& eeprom, uint16_t address, uint16_t capacity, uint8_t version=0,
+                     const EepromMigrationFn * migrations=0);
+
+        /**
+         * @brief Read payload, migrating and rewriting it first if stored at an older version
+         * @param vals Pointer to array of at least capacity bytes into which payload will be placed
+         * @param len Out: length of payload at current version
+         * @return False if record is absent or corrupt, its version is unsupported, or I2C error; true otherwise
+        */
+        bool load(uint8_t * vals, uint16_t& len);
+
+        /**
+         * @brief Write payload at current version into the inactive slot, making it the record once complete
+         * @param vals Pointer to payload
+         * @param len Length of payload; may not exceed capacity
+         * @return False for I2C error or oversized payload, true otherwise
+        */
+        bool store(const uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Migrate stored payload to current version without returning it
+         * @param scratch Buffer of at least capacity bytes
+         * @return False if record is absent, corrupt, unsupported or I2C error; true if current or migrated
+        */
+        bool migrate(uint8_t * scratch);
+
+        /**
+         * @brief Check whether the record is known to be stored at current version
+        */
+        bool isCurrent() const { return _current; }
+
+        /**
+         * @brief Get maximum payload size in bytes
+        */
+        uint16_t capacity() const { return _capacity; }
+
+        /**
+         * @brief Read payload into object of current layout
+        */
+        template <typename T>
+        bool load(T& value)
+        {
+            uint16_t len;
+            return (sizeof(T) <= _capacity) && load((uint8_t*)&value, len) && (len == sizeof(T));
+        }
+
+        /**
+         * @brief Write payload from object of current layout
+        */
+        template <typename T>
+        bool store(const T& value) { return store((const uint8_t*)&value, (uint16_t)sizeof(T)); }
+
+    private:
+        bool     locate();
+        bool     checkSlot(uint8_t slot, bool& valid, uint8_t& sequence);
+        bool     readPayload(uint8_t * vals, uint8_t& version, uint16_t& len);
+        bool     upgrade(uint8_t * vals, uint8_t version, uint16_t& len);
+        uint16_t slotAddress(uint8_t slot) const;
+
+        AT24CXX&                  _eeprom;
+        const EepromMigrationFn * _migrations;
+        uint16_t                  _address;
+        uint16_t                  _capacity;
+        uint8_t                   _version;
+        uint8_t                   _sequence; // sequence of the active slot
+        int8_t                    _active;   // slot holding the record, -1 if neither is valid
+        bool                      _located;
+        bool                      _current;
+};
+
+class EepromRecordSet
+{
+    public:
+       /**
+        * @brief Constructor for EepromRecordSet object
+        * @param scratch Buffer at least as large as the capacity of every registered record
+        * @param scratch_len Size of scratch buffer in bytes
+       */
+        EepromRecordSet(uint8_t * scratch, uint16_t scratch_len);
+
+        /**
+         * @brief Register record for background migration
+         * @return False if set is full or record exceeds scratch buffer, true otherwise
+        */
+        bool add(EepromRecord& record);
+
+        /**
+         * @brief Migrate at most one outdated record of the current pass; intended for idle time. A record
+         *        that cannot be migrated (absent, corrupt, unsupported or I2C error) is left not current and
+         *        skipped until the next pass
+         * @return True while records of the current pass remain unchecked, false once the pass is complete
+        */
+        bool migrateNext();
+
+        /**
+         * @brief Start a new pass over the registered records, retrying any that are still not current
+        */
+        void rewind() { _next = 0; }
+
+    private:
+        EepromRecord* _records[AT24CXX_RECORD_SET_SIZE];
+        uint8_t *     _scratch;
+        uint16_t      _scratch_len;
+        uint8_t       _count;
+        uint8_t       _next;
+};
+
+}
+
+#endif // _AT24CXX_RECORD_H
+
+// EOF
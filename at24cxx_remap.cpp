@@ -0,0 +1,342 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_remap.cpp
+// Purpose     : AT24CXX EEPROM Bad Page Retirement
+// Description : This source file implements header file at24cxx_remap.h.
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <string.h>
+#include "at24cxx_remap.h"
+#include "at24cxx_crc.h"
+
+namespace PeripheralIO
+{
+
+// Table slot: generation(4) spares_used(1) count(1) entries[MAX](bad(2) spare(1)) crc(2)
+const uint16_t REMAP_TABLE_BYTES = 8 + 3 * AT24CXX_REMAP_MAX_SPARES;
+
+EepromRemap::EepromRemap(AT24CXX& eeprom, uint16_t base, uint16_t pages, uint16_t spare_base, uint8_t spares,
+                         uint16_t table_base)
+: _eeprom(eeprom)
+, _base(base)
+, _pages(pages)
+, _spare_base(spare_base)
+, _spares((spares > AT24CXX_REMAP_MAX_SPARES) ? AT24CXX_REMAP_MAX_SPARES : spares)
+, _table_base(table_base)
+, _page_size(eeprom.pageSize())
+, _mounted(false)
+, _active(1)
+, _generation(0)
+, _spares_used(0)
+, _count(0)
+, _verify_threshold(0)
+{
+    memset(_tracked_page, 0, sizeof(_tracked_page));
+    memset(_tracked_fails, 0, sizeof(_tracked_fails));
+}
+
+bool EepromRemap::format()
+{
+    if (!_pages || ((uint32_t)_table_base + 2 * slotLength() > _eeprom.size()))
+        return false;
+
+    _generation  = 0;
+    _spares_used = 0;
+    _count       = 0;
+    _active      = 1;
+    _mounted     = true;
+
+    // Both slots are written so that no stale table from an earlier format can outrank this one
+    if (!persist() || !persist())
+    {
+        _mounted = false;
+        return false;
+    }
+
+    return true;
+}
+
+bool EepromRemap::mount()
+{
+    uint32_t gen_a = 0;
+    uint32_t gen_b = 0;
+    bool     ok_a;
+    bool     ok_b;
+    uint8_t  slot;
+
+    _mounted = false;
+
+    ok_a = readSlot(0, gen_a, false);
+    ok_b = readSlot(1, gen_b, false);
+
+    if (!ok_a && !ok_b)
+        return false;
+
+    // Newest valid slot wins and is loaded once; the generation comparison tolerates wrap
+    slot = (!ok_a || (ok_b && ((int32_t)(gen_b - gen_a) > 0))) ? 1 : 0;
+
+    if (!readSlot(slot, slot ? gen_b : gen_a, true))
+        return false;
+
+    _mounted = true;
+
+    return true;
+}
+
+bool EepromRemap::write(uint16_t address, const uint8_t * vals, uint16_t len)
+{
+    uint16_t done = 0;
+    uint8_t  chunk;
+
+    if (!_mounted || ((uint32_t)(address + len) > size()))
+        return false;
+
+    while (done < len)
+    {
+        uint16_t offset = (uint16_t)((address + done) % _page_size);
+
+        chunk = (uint8_t)(((uint16_t)(_page_size - offset) < (uint16_t)(len - done)) ? (_page_size - offset) : (len - done));
+
+        if (!writeChunk((uint16_t)((address + done) / _page_size), offset, &vals[done], chunk))
+            return false;
+
+        done += chunk;
+    }
+
+    return true;
+}
+
+bool EepromRemap::read(uint16_t address, uint8_t * vals, uint16_t len)
+{
+    uint16_t done = 0;
+    uint16_t chunk;
+
+    if (!_mounted || ((uint32_t)(address + len) > size()))
+        return false;
+
+    // Runs of pages left in place are read in one transaction
+    while (done < len)
+    {
+        uint16_t page   = (uint16_t)((address + done) / _page_size);
+        uint16_t offset = (uint16_t)((address + done) % _page_size);
+        uint16_t start  = physical(page);
+
+        chunk = (uint16_t)(_page_size - offset);
+
+        while (((uint32_t)done + chunk < len) && (physical((uint16_t)(page + 1)) == start + (chunk + offset)))
+        {
+            page++;
+            chunk = (uint16_t)(chunk + _page_size);
+        }
+
+        if (chunk > (len - done))
+            chunk = (uint16_t)(len - done);
+
+        if (!_eeprom.read((uint16_t)(start + offset), &vals[done], chunk))
+            return false;
+
+        done += chunk;
+    }
+
+    return true;
+}
+
+bool EepromRemap::retire(uint16_t page)
+{
+    uint8_t  data[AT24CXX_MAX_PAGE_SIZE];
+    uint16_t bad[AT24CXX_REMAP_MAX_SPARES];
+    uint8_t  spare[AT24CXX_REMAP_MAX_SPARES];
+    uint8_t  count = _count;
+    uint8_t  entry;
+
+    if (!_mounted || (page >= _pages) || (_spares_used >= _spares))
+        return false;
+
+    if (!_eeprom.read(physical(page), data, _page_size))
+        return false;
+
+    if (!_eeprom.write((uint16_t)(_spare_base + _spares_used * _page_size), data, _page_size))
+        return false;
+
+    memcpy(bad, _bad, sizeof(bad));
+    memcpy(spare, _spare, sizeof(spare));
+
+    // A failing spare is replaced in its existing entry
+    for (entry = 0; (entry < _count) && (_bad[entry] != page); entry++)
+        ;
+
+    if (entry == _count)
+        _count++;
+
+    _bad[entry]   = page;
+    _spare[entry] = _spares_used++;
+
+    if (!persist())
+    {
+        memcpy(_bad, bad, sizeof(bad));
+        memcpy(_spare, spare, sizeof(spare));
+        _count = count;
+        _spares_used--;
+        return false;
+    }
+
+    for (uint8_t i = 0; i < AT24CXX_REMAP_TRACKED; i++)
+    {
+        if (_tracked_page[i] == page)
+            _tracked_fails[i] = 0;
+    }
+
+    return true;
+}
+
+// Private: Write table to the inactive slot under the next generation
+bool EepromRemap::persist()
+{
+    uint8_t  table[REMAP_TABLE_BYTES];
+    uint8_t  slot = (uint8_t)(_active ^ 1);
+    uint16_t crc;
+
+    memset(table, 0, sizeof(table));
+
+    table[0] = (uint8_t)((_generation + 1) & 0xFF);
+    table[1] = (uint8_t)(((_generation + 1) >> 8) & 0xFF);
+    table[2] = (uint8_t)(((_generation + 1) >> 16) & 0xFF);
+    table[3] = (uint8_t)((_generation + 1) >> 24);
+    table[4] = _spares_used;
+    table[5] = _count;
+
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        table[6 + i * 3]     = (uint8_t)(_bad[i] & 0xFF);
+        table[6 + i * 3 + 1] = (uint8_t)(_bad[i] >> 8);
+        table[6 + i * 3 + 2] = _spare[i];
+    }
+
+    crc = crc16(table, REMAP_TABLE_BYTES - 2);
+    table[REMAP_TABLE_BYTES - 2] = (uint8_t)(crc & 0xFF);
+    table[REMAP_TABLE_BYTES - 1] = (uint8_t)(crc >> 8);
+
+    if (!_eeprom.write((uint16_t)(_table_base + slot * slotLength()), table, REMAP_TABLE_BYTES))
+        return false;
+
+    _generation++;
+    _active = slot;
+
+    return true;
+}
+
+// Private: Read and validate a table slot, optionally loading it into RAM when valid
+bool EepromRemap::readSlot(uint8_t slot, uint32_t& generation, bool load)
+{
+    uint8_t table[REMAP_TABLE_BYTES];
+
+    if (!_eeprom.read((uint16_t)(_table_base + slot * slotLength()), table, REMAP_TABLE_BYTES))
+        return false;
+
+    if (crc16(table, REMAP_TABLE_BYTES - 2) !=
+        (uint16_t)(table[REMAP_TABLE_BYTES - 2] | (table[REMAP_TABLE_BYTES - 1] << 8)))
+        return false;
+
+    if ((table[4] > _spares) || (table[5] > table[4]))
+        return false;
+
+    generation   = (uint32_t)table[0] | ((uint32_t)table[1] << 8) | ((uint32_t)table[2] << 16) |
+                   ((uint32_t)table[3] << 24);
+
+    if (!load)
+        return true;
+
+    _generation  = generation;
+    _spares_used = table[4];
+    _count       = table[5];
+    _active      = slot;
+
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        _bad[i]   = (uint16_t)(table[6 + i * 3] | (table[6 + i * 3 + 1] << 8));
+        _spare[i] = table[6 + i * 3 + 2];
+    }
+
+    return true;
+}
+
+// Private: Write chunk within one logical page, verifying and retiring as configured
+bool EepromRemap::writeChunk(uint16_t page, uint16_t offset, const uint8_t * vals, uint8_t len)
+{
+    uint8_t check[AT24CXX_MAX_PAGE_SIZE];
+
+    for (;;)
+    {
+        uint16_t address = (uint16_t)(physical(page) + offset);
+
+        if (!_eeprom.write(address, (uint8_t*)vals, len))
+            return false;
+
+        if (!_verify_threshold)
+            return true;
+
+        if (!_eeprom.read(address, check, len))
+            return false;
+
+        if (0 == memcmp(check, vals, len))
+            return true;
+
+        // Retry in place until the page has failed often enough, then move it to a spare
+        if ((noteFailure(page) >= _verify_threshold) && !retire(page))
+            return false;
+    }
+}
+
+// Private: Count a verify failure of a page, evicting the least failed tracked page if needed
+uint8_t EepromRemap::noteFailure(uint16_t page)
+{
+    uint8_t slot = 0;
+
+    for (uint8_t i = 0; i < AT24CXX_REMAP_TRACKED; i++)
+    {
+        if ((_tracked_page[i] == page) && _tracked_fails[i])
+        {
+            slot = i;
+            break;
+        }
+
+        if (_tracked_fails[i] < _tracked_fails[slot])
+            slot = i;
+    }
+
+    if ((_tracked_page[slot] != page) || !_tracked_fails[slot])
+    {
+        _tracked_page[slot]  = page;
+        _tracked_fails[slot] = 0;
+    }
+
+    if (_tracked_fails[slot] < 0xFF)
+        _tracked_fails[slot]++;
+
+    return _tracked_fails[slot];
+}
+
+// Private: Physical address of a logical page
+uint16_t EepromRemap::physical(uint16_t page) const
+{
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        if (_bad[i] == page)
+            return (uint16_t)(_spare_base + _spare[i] * _page_size);
+    }
+
+    return (uint16_t)(_base + page * _page_size);
+}
+
+// Private: Bytes reserved per table slot, in whole pages
+uint16_t EepromRemap::slotLength() const
+{
+    return (uint16_t)(((REMAP_TABLE_BYTES + _page_size - 1) / _page_size) * _page_size);
+}
+
+}
+
+// EOF
@@ -0,0 +1,142 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_remap.h
+// Purpose     : AT24CXX EEPROM Bad Page Retirement
+// Description :
+//               Presents a page-aligned region through its own linear address space, in which pages that have
+//               failed may be retired and transparently substituted by pages from a reserved spare pool. The
+//               retirement table maps bad logical pages to spares and is persisted in two alternating slots under
+//               an incrementing generation and CRC, so an interrupted update leaves the previous table intact. It
+//               is cached in RAM at mount(), so translation adds no bus transactions.
+//
+//               Pages are retired explicitly with retire(), e.g. when ECC or the scrubber reports repeated errors,
+//               or automatically when verify-after-write is enabled: every written chunk is then read back, and a
+//               page whose writes fail to verify the configured number of times is retired and the write
+//               repeated on its spare. A retired spare that fails in turn is itself replaced.
+//
+//               Each table slot occupies enough whole pages to hold 8 + 3 * AT24CXX_REMAP_MAX_SPARES bytes.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_REMAP_H
+#define _AT24CXX_REMAP_H
+
+#include "at24cxx.h"
+
+// Largest spare pool, and so the number of retirements over the life of the region
+#ifndef AT24CXX_REMAP_MAX_SPARES
+#define AT24CXX_REMAP_MAX_SPARES 8
+#endif
+
+// Number of pages whose verify failures are tracked at once
+#ifndef AT24CXX_REMAP_TRACKED
+#define AT24CXX_REMAP_TRACKED 4
+#endif
+
+namespace PeripheralIO
+{
+
+class EepromRemap
+{
+    public:
+       /**
+        * @brief Constructor for EepromRemap object
+        * @param eeprom Reference to initialized AT24CXX object
+        * @param base Page-aligned starting address of the data pages
+        * @param pages Number of data pages
+        * @param spare_base Page-aligned starting address of the spare pool
+        * @param spares Number of spare pages, at most AT24CXX_REMAP_MAX_SPARES
+        * @param table_base Page-aligned starting address of the two table slots
+       */
+        EepromRemap(AT24CXX& eeprom, uint16_t base, uint16_t pages, uint16_t spare_base, uint8_t spares,
+                    uint16_t table_base);
+
+        /**
+         * @brief Write an empty retirement table, discarding all substitutions
+         * @return False for I2C error or invalid geometry, true otherwise
+        */
+        bool format();
+
+        /**
+         * @brief Load the newest valid retirement table into RAM; must be called prior to use
+         * @return False if no valid table is present (format() required) or I2C error, true otherwise
+        */
+        bool mount();
+
+        /**
+         * @brief Write through the retirement table
+         * @param address Starting logical address
+         * @param vals Pointer to values to write
+         * @param len Number of bytes to write
+         * @return False for I2C error, verify failure, invalid request or not mounted; true otherwise
+        */
+        bool write(uint16_t address, const uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Read through the retirement table
+         * @param address Starting logical address
+         * @param vals Pointer to array into which read values will be placed
+         * @param len Number of bytes to read
+         * @return False for I2C error, invalid request or not mounted; true otherwise
+        */
+        bool read(uint16_t address, uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Substitute a spare for a logical page, copying its current contents, and persist the table
+         * @param page Logical page index
+         * @return False for I2C error, page out of range or spare pool exhausted; true otherwise
+        */
+        bool retire(uint16_t page);
+
+        /**
+         * @brief Enable verify-after-write
+         * @param threshold Verify failures of one page before it is retired; 0 disables verification
+        */
+        void setVerify(uint8_t threshold) { _verify_threshold = threshold; }
+
+        /**
+         * @brief Get number of spares consumed
+        */
+        uint8_t sparesUsed() const { return _spares_used; }
+
+        /**
+         * @brief Get logical capacity in bytes
+        */
+        uint32_t size() const { return (uint32_t)_pages * _page_size; }
+
+    private:
+        bool     persist();
+        bool     readSlot(uint8_t slot, uint32_t& generation, bool load);
+        bool     writeChunk(uint16_t page, uint16_t offset, const uint8_t * vals, uint8_t len);
+        uint8_t  noteFailure(uint16_t page);
+        uint16_t physical(uint16_t page) const;
+        uint16_t slotLength() const;
+
+        AT24CXX& _eeprom;
+        uint16_t _base;
+        uint16_t _pages;
+        uint16_t _spare_base;
+        uint8_t  _spares;
+        uint16_t _table_base;
+        uint16_t _page_size;
+        bool     _mounted;
+        uint8_t  _active;
+        uint32_t _generation;
+        uint8_t  _spares_used;
+        uint8_t  _count;
+        uint16_t _bad[AT24CXX_REMAP_MAX_SPARES];
+        uint8_t  _spare[AT24CXX_REMAP_MAX_SPARES];
+        uint8_t  _verify_threshold;
+        uint16_t _tracked_page[AT24CXX_REMAP_TRACKED];
+        uint8_t  _tracked_fails[AT24CXX_REMAP_TRACKED];
+};
+
+}
+
+#endif // _AT24CXX_REMAP_H
+
+// EOF
@@ -0,0 +1,288 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_ring.h
+// Purpose     : AT24CXX EEPROM Fixed-Size Record Ring
+// Description :
+//               Circular log of fixed-size records of trivially copyable type T. Records are packed whole into
+//               pages, so that no record straddles a page boundary; the slack at the end of each page is left
+//               unused. A record append costs one write cycle where the driver writes whole pages, and one per
+//               sub-page the slot touches where AT24CXX_I2C_WRITE_MAX splits pages. Each slot is prefixed by a
+//               16-bit lap stamp, the number of times the ring had wrapped when the slot was written, and followed
+//               by a CRC-16 over stamp and record.
+//
+//               The stamps make the ring's position self-describing: slots before the write head carry the
+//               current lap and slots from the head onward carry the previous one, so mount() locates the head by
+//               binary search in O(log n) small reads rather than scanning, and no separately stored index is
+//               rewritten on every append. Wear is thereby spread evenly over all slots. Once mounted, at(i)
+//               computes the physical address of the i-th oldest record directly.
+//
+//               A slot torn by a reset part way through its write may carry the new stamp with a stale or partial
+//               record; its CRC no longer matches, and at() reports it as an error rather than returning it.
+//
+//               The region must be formatted once with format(), which stamps every slot as never written.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//                          at24cxx_crc.h
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_RING_H
+#define _AT24CXX_RING_H
+
+#include <string.h>
+#include "at24cxx.h"
+#include "at24cxx_crc.h"
+
+namespace PeripheralIO
+{
+
+template <typename T>
+class EepromRecordRing
+{
+    public:
+       /**
+        * @brief Constructor for EepromRecordRing object
+        * @param eeprom Reference to initialized AT24CXX object
+        * @param base Page-aligned starting address of the ring
+        * @param pages Number of pages occupied by the ring
+       */
+        EepromRecordRing(AT24CXX& eeprom, uint16_t base, uint16_t pages)
+        : _eeprom(eeprom)
+        , _base(base)
+        , _page_size(eeprom.pageSize())
+        , _per_page((uint16_t)(eeprom.pageSize() / SLOT_SIZE))
+        , _capacity((uint16_t)(pages * (eeprom.pageSize() / SLOT_SIZE)))
+        , _head(0)
+        , _count(0)
+        , _lap(1)
+        { }
+
+        /**
+         * @brief Stamp every slot as never written, emptying the ring
+         * @return False for I2C error or record larger than a page, true otherwise
+        */
+        bool format()
+        {
+            uint8_t page[AT24CXX_MAX_PAGE_SIZE];
+
+            if (0 == _capacity)
+                return false;
+
+            memset(page, 0, sizeof(page));
+
+            for (uint16_t i = 0; i < _capacity; i += _per_page)
+            {
+                if (!_eeprom.write(slotAddress(i), page, (uint16_t)(_per_page * SLOT_SIZE)))
+                    return false;
+            }
+
+            _head  = 0;
+            _count = 0;
+            _lap   = 1;
+
+            return true;
+        }
+
+        /**
+         * @brief Locate write head and record count from slot stamps; must be called prior to use
+         * @return False for I2C error or record larger than a page, true otherwise
+        */
+        bool mount()
+        {
+            uint16_t first;
+            uint16_t stamp;
+            uint16_t lo = 1;
+            uint16_t hi;
+            uint16_t mid;
+
+            if ((0 == _capacity) || !readStamp(0, first))
+                return false;
+
+            _head  = 0;
+            _count = 0;
+            _lap   = 1;
+
+            if (0 == first)
+                return true;
+
+            // First slot whose stamp differs from slot 0 is the write head
+            hi = _capacity;
+
+            while (lo < hi)
+            {
+                mid = (uint16_t)(lo + (hi - lo) / 2);
+
+                if (!readStamp(mid, stamp))
+                    return false;
+
+                if (stamp == first)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+
+            if (lo == _capacity)
+            {
+                _lap   = nextLap(first);
+                _count = _capacity;
+                return true;
+            }
+
+            if (!readStamp(lo, stamp))
+                return false;
+
+            _head  = lo;
+            _lap   = first;
+            _count = (0 == stamp) ? lo : _capacity;
+
+            return true;
+        }
+
+        /**
+         * @brief Append record, overwriting the oldest record once the ring is full
+         * @param item Record to append
+         * @return False for I2C error, true otherwise
+        */
+        bool append(const T& item)
+        {
+            return append(&item, 1);
+        }
+
+        /**
+         * @brief Append consecutive records, issuing one write per page touched
+         * @param items Pointer to records to append
+         * @param n Number of records to append
+         * @return False for I2C error, true otherwise
+        */
+        bool append(const T * items, uint16_t n)
+        {
+            uint8_t  page[AT24CXX_MAX_PAGE_SIZE];
+            uint16_t run;
+            uint16_t done = 0;
+
+            if (0 == _capacity)
+                return false;
+
+            while (done < n)
+            {
+                // Slots from head to the end of its page are written as one chunk
+                run = (uint16_t)(_per_page - (_head % _per_page));
+
+                if (run > (n - done))
+                    run = n - done;
+
+                for (uint16_t i = 0; i < run; i++)
+                {
+                    uint8_t * slot = &page[i * SLOT_SIZE];
+                    uint16_t  crc;
+
+                    slot[0] = (uint8_t)(_lap & 0xFF);
+                    slot[1] = (uint8_t)(_lap >> 8);
+                    memcpy(&slot[2], &items[done + i], sizeof(T));
+
+                    crc = crc16(slot, (uint16_t)(sizeof(T) + 2));
+                    slot[sizeof(T) + 2] = (uint8_t)(crc & 0xFF);
+                    slot[sizeof(T) + 3] = (uint8_t)(crc >> 8);
+                }
+
+                if (!_eeprom.write(slotAddress(_head), page, (uint16_t)(run * SLOT_SIZE)))
+                    return false;
+
+                done  += run;
+                _head += run;
+                _count = ((uint32_t)(_count + run) < _capacity) ? (uint16_t)(_count + run) : _capacity;
+
+                if (_head == _capacity)
+                {
+                    _head = 0;
+                    _lap  = nextLap(_lap);
+                }
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Read record by logical index, 0 being the oldest
+         * @param index Logical index of record; must be less than size()
+         * @param item Object into which record will be placed
+         * @return False for I2C error, index out of range or CRC mismatch, true otherwise
+        */
+        bool at(uint16_t index, T& item)
+        {
+            uint8_t  raw[SLOT_SIZE];
+            uint16_t slot;
+
+            if (index >= _count)
+                return false;
+
+            slot = (uint16_t)(((uint32_t)oldest() + index) % _capacity);
+
+            if (!_eeprom.read(slotAddress(slot), raw, SLOT_SIZE))
+                return false;
+
+            if (crc16(raw, (uint16_t)(sizeof(T) + 2)) != (uint16_t)(raw[sizeof(T) + 2] | (raw[sizeof(T) + 3] << 8)))
+                return false;
+
+            memcpy(&item, &raw[2], sizeof(T));
+            return true;
+        }
+
+        /**
+         * @brief Get number of records held
+        */
+        uint16_t size() const { return _count; }
+
+        /**
+         * @brief Get maximum number of records held before the oldest is overwritten
+        */
+        uint16_t capacity() const { return _capacity; }
+
+    private:
+        // Lap stamp, record, CRC-16
+        static const uint16_t SLOT_SIZE = sizeof(T) + 4;
+
+        uint16_t oldest() const
+        {
+            return (_count < _capacity) ? 0 : _head;
+        }
+
+        uint16_t slotAddress(uint16_t slot) const
+        {
+            return (uint16_t)(_base + (slot / _per_page) * _page_size + (slot % _per_page) * SLOT_SIZE);
+        }
+
+        bool readStamp(uint16_t slot, uint16_t& stamp)
+        {
+            uint8_t raw[2];
+
+            if (!_eeprom.read(slotAddress(slot), raw, 2))
+                return false;
+
+            stamp = (uint16_t)(raw[0] | (raw[1] << 8));
+            return true;
+        }
+
+        static uint16_t nextLap(uint16_t lap)
+        {
+            // Zero is reserved for slots never written
+            return (0xFFFF == lap) ? 1 : (uint16_t)(lap + 1);
+        }
+
+        AT24CXX& _eeprom;
+        uint16_t _base;
+        uint16_t _page_size;
+        uint16_t _per_page;
+        uint16_t _capacity;
+        uint16_t _head;
+        uint16_t _count;
+        uint16_t _lap;
+};
+
+}
+
+#endif // _AT24CXX_RING_H
+
+// EOF
@@ -0,0 +1,166 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_scrub.cpp
+// Purpose     : AT24CXX EEPROM Background Scrubber
+// Description : This source file implements header file at24cxx_scrub.h.
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <string.h>
+#include "at24cxx_scrub.h"
+#include "at24cxx_crc.h"
+
+namespace PeripheralIO
+{
+
+// Datasheet maximum write cycle, charged to the budget for every rewrite
+const uint32_t SCRUB_WRITE_CYCLE_US = 5000;
+
+EepromScrubber::EepromScrubber(AT24CXX& eeprom, uint16_t base, uint16_t pages, uint32_t bus_hz)
+: _eeprom(eeprom)
+, _base(base)
+, _pages(pages)
+, _page_size(eeprom.pageSize())
+, _bus_hz(bus_hz ? bus_hz : 100000)
+, _rate_us(0)
+, _burst_us(0)
+, _tokens_us(0)
+, _last_ms(0)
+, _started(false)
+, _cursor(0)
+, _refresh_passes(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+bool EepromScrubber::writePage(uint16_t page, const uint8_t * payload)
+{
+    uint8_t  raw[AT24CXX_MAX_PAGE_SIZE];
+    uint16_t crc;
+
+    if (page >= _pages)
+        return false;
+
+    memcpy(raw, payload, payloadSize());
+    crc = crc16(raw, payloadSize());
+
+    raw[_page_size - 2] = (uint8_t)(crc & 0xFF);
+    raw[_page_size - 1] = (uint8_t)(crc >> 8);
+
+    return _eeprom.write((uint16_t)(_base + page * _page_size), raw, _page_size);
+}
+
+bool EepromScrubber::readPage(uint16_t page, uint8_t * payload)
+{
+    uint8_t raw[AT24CXX_MAX_PAGE_SIZE];
+    bool    corrected;
+    bool    valid;
+
+    if ((page >= _pages) || !readSealed(page, raw, corrected, valid) || !valid)
+        return false;
+
+    memcpy(payload, raw, payloadSize());
+
+    return true;
+}
+
+void EepromScrubber::setBudget(uint32_t us_per_second, uint32_t burst_us)
+{
+    _rate_us  = us_per_second;
+    _burst_us = (burst_us > 0x7FFFFFFF) ? 0x7FFFFFFF : burst_us;
+}
+
+bool EepromScrubber::step(uint32_t now_ms)
+{
+    uint8_t  raw[AT24CXX_MAX_PAGE_SIZE];
+    uint32_t read_us  = transferUs((uint16_t)(_page_size + 4));
+    uint32_t write_us = transferUs((uint16_t)(_page_size + 3)) + SCRUB_WRITE_CYCLE_US;
+    uint64_t accrued;
+    bool     refresh;
+    bool     corrected;
+    bool     valid;
+
+    if (!_started)
+    {
+        _started = true;
+        _last_ms = now_ms;
+    }
+
+    accrued  = (uint64_t)(uint32_t)(now_ms - _last_ms) * _rate_us / 1000;
+    _last_ms = now_ms;
+
+    if ((int64_t)_tokens_us + (int64_t)accrued > (int64_t)_burst_us)
+        _tokens_us = (int32_t)_burst_us;
+    else
+        _tokens_us = (int32_t)(_tokens_us + (int64_t)accrued);
+
+    if (!_pages || _eeprom.busy())
+        return true;
+
+    // Every refresh interval, the final pass rewrites each page regardless of its condition
+    refresh = _refresh_passes && ((_stats.passes % _refresh_passes) == (uint32_t)(_refresh_passes - 1));
+
+    if (_tokens_us < (int32_t)(read_us + (refresh ? write_us : 0)))
+        return true;
+
+    _tokens_us -= (int32_t)read_us;
+
+    if (!readSealed(_cursor, raw, corrected, valid))
+        return false;
+
+    _stats.checked++;
+
+    if (!valid)
+    {
+        _stats.uncorrectable++;
+    }
+    else if (corrected || refresh)
+    {
+        _tokens_us -= (int32_t)write_us;
+
+        if (!_eeprom.write((uint16_t)(_base + _cursor * _page_size), raw, _page_size))
+            return false;
+
+        if (corrected)
+            _stats.corrected++;
+        else
+            _stats.refreshed++;
+    }
+
+    if (++_cursor >= _pages)
+    {
+        _cursor = 0;
+        _stats.passes++;
+    }
+
+    return true;
+}
+
+// Private: Read raw sealed page, repairing a single-bit error in place
+bool EepromScrubber::readSealed(uint16_t page, uint8_t * raw, bool& corrected, bool& valid)
+{
+    uint16_t crc;
+
+    if (!_eeprom.read((uint16_t)(_base + page * _page_size), raw, _page_size))
+        return false;
+
+    crc   = (uint16_t)(raw[_page_size - 2] | (raw[_page_size - 1] << 8));
+    valid = crc16Correct(raw, payloadSize(), crc, corrected);
+
+    raw[_page_size - 2] = (uint8_t)(crc & 0xFF);
+    raw[_page_size - 1] = (uint8_t)(crc >> 8);
+
+    return true;
+}
+
+// Private: Estimated bus time of a transfer, at nine clocks per byte
+uint32_t EepromScrubber::transferUs(uint16_t bytes) const
+{
+    return (uint32_t)(((uint64_t)bytes * 9 * 1000000 + _bus_hz - 1) / _bus_hz);
+}
+
+}
+
+// EOF
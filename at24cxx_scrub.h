@@ -0,0 +1,133 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_scrub.h
+// Purpose     : AT24CXX EEPROM Background Scrubber
+// Description :
+//               Idle-time integrity scrubbing of a page-aligned region stored in sealed page format: each page
+//               holds pageSize() - 2 bytes of payload followed by a little-endian CRC-16 of the payload.
+//               Applications access the region through writePage() and readPage(); the latter repairs a single
+//               flipped bit in RAM before returning the payload.
+//
+//               step(), called from the application's idle loop, visits the pages in turn. A page is read and
+//               checked, and is rewritten when it showed a corrected error, or, every refresh interval of full
+//               passes, unconditionally, so that charge lost to retention ageing is restored before decay becomes
+//               uncorrectable. Uncorrectable pages are counted and left untouched.
+//
+//               Scrubbing is paced by a token bucket of bus time: the budget accrues at a configured number of
+//               microseconds per second up to a burst limit, and a page is only visited when the budget covers
+//               its estimated read time, plus its write time and write cycle if it is due for refresh. A page
+//               found to need repair is rewritten at once, within the same step, so that foreground writes are
+//               never overwritten with stale data; the budget may thereby be overdrawn, and the debt is repaid
+//               before the next visit. With AT24CXX_DEFERRED_WRITE_CYCLE, step() also stands aside while the
+//               device is busy.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_SCRUB_H
+#define _AT24CXX_SCRUB_H
+
+#include "at24cxx.h"
+
+namespace PeripheralIO
+{
+
+struct EepromScrubStats
+{
+    uint32_t checked;       // pages read and verified
+    uint32_t corrected;     // pages rewritten after a corrected error
+    uint32_t refreshed;     // pages rewritten for retention
+    uint32_t uncorrectable; // pages failing verification
+    uint32_t passes;        // full passes completed
+};
+
+class EepromScrubber
+{
+    public:
+       /**
+        * @brief Constructor for EepromScrubber object
+        * @param eeprom Reference to initialized AT24CXX object
+        * @param base Page-aligned starting address of the sealed region
+        * @param pages Number of pages in the region
+        * @param bus_hz I2C clock rate, used to estimate transfer times
+       */
+        EepromScrubber(AT24CXX& eeprom, uint16_t base, uint16_t pages, uint32_t bus_hz=100000);
+
+        /**
+         * @brief Write a page in sealed format
+         * @param page Page index within the region
+         * @param payload Pointer to payloadSize() bytes
+         * @return False for I2C error or page out of range, true otherwise
+        */
+        bool writePage(uint16_t page, const uint8_t * payload);
+
+        /**
+         * @brief Read and verify a sealed page, repairing a single-bit error in the returned payload
+         * @param page Page index within the region
+         * @param payload Pointer to payloadSize() bytes
+         * @return False for I2C error, uncorrectable page or page out of range, true otherwise
+        */
+        bool readPage(uint16_t page, uint8_t * payload);
+
+        /**
+         * @brief Set bus time budget
+         * @param us_per_second Bus time accrued per second of elapsed time
+         * @param burst_us Largest budget accrued while idle
+        */
+        void setBudget(uint32_t us_per_second, uint32_t burst_us);
+
+        /**
+         * @brief Set retention refresh interval
+         * @param passes Every page is rewritten on every passes-th full pass; 0 rewrites only corrected pages
+        */
+        void setRefreshInterval(uint16_t passes) { _refresh_passes = passes; }
+
+        /**
+         * @brief Restore the pass counter, e.g. from persisted stats, so that refresh timing survives resets
+        */
+        void setPasses(uint32_t passes) { _stats.passes = passes; }
+
+        /**
+         * @brief Visit the next page if the budget allows; call from idle time
+         * @param now_ms Current time in milliseconds
+         * @return False for I2C error, true otherwise
+        */
+        bool step(uint32_t now_ms);
+
+        /**
+         * @brief Get payload bytes per page
+        */
+        uint16_t payloadSize() const { return (uint16_t)(_page_size - 2); }
+
+        /**
+         * @brief Get scrub counters
+        */
+        const EepromScrubStats& stats() const { return _stats; }
+
+    private:
+        bool     readSealed(uint16_t page, uint8_t * raw, bool& corrected, bool& valid);
+        uint32_t transferUs(uint16_t bytes) const;
+
+        AT24CXX&         _eeprom;
+        uint16_t         _base;
+        uint16_t         _pages;
+        uint16_t         _page_size;
+        uint32_t         _bus_hz;
+        uint32_t         _rate_us;
+        uint32_t         _burst_us;
+        int32_t          _tokens_us;
+        uint32_t         _last_ms;
+        bool             _started;
+        uint16_t         _cursor;
+        uint16_t         _refresh_passes;
+        EepromScrubStats _stats;
+};
+
+}
+
+#endif // _AT24CXX_SCRUB_H
+
+// EOF
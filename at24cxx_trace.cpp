@@ -0,0 +1,110 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_trace.cpp
+// Purpose     : AT24CXX EEPROM Access Trace Recording
+// Description : This source file implements header file at24cxx_trace.h.
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include "at24cxx_trace.h"
+
+namespace PeripheralIO
+{
+
+// Private: Little-endian field helpers
+static void put16(uint8_t * out, uint16_t val)
+{
+    out[0] = (uint8_t)(val & 0xFF);
+    out[1] = (uint8_t)(val >> 8);
+}
+
+static void put32(uint8_t * out, uint32_t val)
+{
+    put16(out, (uint16_t)(val & 0xFFFF));
+    put16(out + 2, (uint16_t)(val >> 16));
+}
+
+static uint16_t get16(const uint8_t * in)
+{
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get32(const uint8_t * in)
+{
+    return (uint32_t)get16(in) | ((uint32_t)get16(in + 2) << 16);
+}
+
+
+EepromTraceBuffer::EepromTraceBuffer()
+: _head(0)
+, _count(0)
+, _dropped(0)
+{ }
+
+void EepromTraceBuffer::hook(void * context, const EepromTraceEvent& event)
+{
+    ((EepromTraceBuffer*)context)->record(event);
+}
+
+void EepromTraceBuffer::record(const EepromTraceEvent& event)
+{
+    _events[(_head + _count) % AT24CXX_TRACE_DEPTH] = event;
+
+    if (_count < AT24CXX_TRACE_DEPTH)
+    {
+        _count++;
+    }
+    else
+    {
+        _head = (uint16_t)((_head + 1) % AT24CXX_TRACE_DEPTH);
+        _dropped++;
+    }
+}
+
+uint16_t EepromTraceBuffer::drain(EepromTraceEvent * events, uint16_t max)
+{
+    uint16_t n = 0;
+
+    while ((n < max) && _count)
+    {
+        events[n++] = _events[_head];
+        _head       = (uint16_t)((_head + 1) % AT24CXX_TRACE_DEPTH);
+        _count--;
+    }
+
+    return n;
+}
+
+void EepromTraceBuffer::encodeHeader(uint32_t chip_size, uint8_t * out)
+{
+    put32(out, AT24CXX_TRACE_MAGIC);
+    put32(out + 4, chip_size);
+}
+
+void EepromTraceBuffer::encode(const EepromTraceEvent& event, uint8_t * out)
+{
+    put32(out, event.timestamp_us);
+    put32(out + 4, event.duration_us);
+    put16(out + 8, event.address);
+    put16(out + 10, event.len);
+    out[12] = event.op;
+    out[13] = event.ok;
+    out[14] = 0;
+    out[15] = 0;
+}
+
+void EepromTraceBuffer::decode(const uint8_t * in, EepromTraceEvent& event)
+{
+    event.timestamp_us = get32(in);
+    event.duration_us  = get32(in + 4);
+    event.address      = get16(in + 8);
+    event.len          = get16(in + 10);
+    event.op           = in[12];
+    event.ok           = in[13];
+}
+
+}
+
+// EOF
@@ -0,0 +1,126 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : at24cxx_trace.h
+// Purpose     : AT24CXX EEPROM Access Trace Recording
+// Description :
+//               Compact trace of driver calls for capturing production workloads, to be replayed by the host tool
+//               (host/trace_replay.h) when tuning driver and module configuration. Each event records the
+//               operation, address, length, start timestamp, duration and outcome of one read() or write() call;
+//               the data itself is never captured.
+//
+//               Tracing is compiled in only when AT24CXX_TRACE is defined for the whole build, in which case
+//               AT24CXX gains setTraceHook() and the HAL must provide HAL::micros(). Without it the driver is
+//               unchanged. EepromTraceBuffer is a ready-made RAM ring sink: the application installs it as hook
+//               and periodically drains events into a trace file, flash or a serial link.
+//
+//               Serialized trace: an 8-byte header (magic, chip size) followed by fixed 16-byte events, all
+//               fields little-endian.
+//
+// Language    : C++
+// Platform    : Portable
+// Framework   : Portable
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Custom implementation-defined Hardware Abstraction Layer
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _AT24CXX_TRACE_H
+#define _AT24CXX_TRACE_H
+
+#include "hal.h"
+
+// Events held by an EepromTraceBuffer before the oldest is dropped
+#ifndef AT24CXX_TRACE_DEPTH
+#define AT24CXX_TRACE_DEPTH 64
+#endif
+
+#define AT24CXX_TRACE_MAGIC        0x54343241 // "A24T"
+#define AT24CXX_TRACE_HEADER_SIZE  8
+#define AT24CXX_TRACE_EVENT_SIZE   16
+
+namespace PeripheralIO
+{
+
+enum EepromTraceOp
+{
+    EEPROM_TRACE_READ  = 1,
+    EEPROM_TRACE_WRITE = 2
+};
+
+struct EepromTraceEvent
+{
+    uint32_t timestamp_us; // HAL::micros() at call
+    uint32_t duration_us;
+    uint16_t address;
+    uint16_t len;
+    uint8_t  op;           // EepromTraceOp
+    uint8_t  ok;           // call returned true
+};
+
+typedef void (*EepromTraceHook)(void * context, const EepromTraceEvent& event);
+
+class EepromTraceBuffer
+{
+    public:
+        EepromTraceBuffer();
+
+        /**
+         * @brief Hook function to pass to AT24CXX::setTraceHook() with this buffer as context
+        */
+        static void hook(void * context, const EepromTraceEvent& event);
+
+        /**
+         * @brief Append event, dropping the oldest if full
+         * @param event Event to record
+        */
+        void record(const EepromTraceEvent& event);
+
+        /**
+         * @brief Remove oldest events
+         * @param events Pointer to array into which events will be placed
+         * @param max Capacity of array
+         * @return Number of events removed
+        */
+        uint16_t drain(EepromTraceEvent * events, uint16_t max);
+
+        /**
+         * @brief Get number of events held
+        */
+        uint16_t count() const { return _count; }
+
+        /**
+         * @brief Get number of events dropped on overflow since construction
+        */
+        uint32_t dropped() const { return _dropped; }
+
+        /**
+         * @brief Serialize trace file header
+         * @param chip_size Size in bytes of the traced chip, from AT24CXX::size()
+         * @param out Pointer to AT24CXX_TRACE_HEADER_SIZE bytes
+        */
+        static void encodeHeader(uint32_t chip_size, uint8_t * out);
+
+        /**
+         * @brief Serialize event
+         * @param event Event to serialize
+         * @param out Pointer to AT24CXX_TRACE_EVENT_SIZE bytes
+        */
+        static void encode(const EepromTraceEvent& event, uint8_t * out);
+
+        /**
+         * @brief Deserialize event
+         * @param in Pointer to AT24CXX_TRACE_EVENT_SIZE bytes
+         * @param event Out: decoded event
+        */
+        static void decode(const uint8_t * in, EepromTraceEvent& event);
+
+    private:
+        EepromTraceEvent _events[AT24CXX_TRACE_DEPTH];
+        uint16_t         _head;
+        uint16_t         _count;
+        uint32_t         _dropped;
+};
+
+}
+
+#endif // _AT24CXX_TRACE_H
+
+// EOF
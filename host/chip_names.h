@@ -0,0 +1,52 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : chip_names.h
+// Purpose     : AT24CXX Chip Name Lookup for Host Tools
+// Description : Maps part names given on host tool command lines (e.g. "AT24C256") to chip selection constants.
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : at24cxx.h
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _CHIP_NAMES_H
+#define _CHIP_NAMES_H
+
+#include <strings.h>
+#include "at24cxx.h"
+
+namespace PeripheralIO
+{
+
+/**
+ * @brief Look up chip selection constant by part name, ignoring case
+ * @param name Part name, e.g. "AT24C256"
+ * @param chip Out: chip selection constant
+ * @return False for unknown part, true otherwise
+*/
+inline bool chipByName(const char * name, uint32_t& chip)
+{
+    static const struct { const char * name; const uint32_t* chip; } chips[] =
+    {
+        { "AT24C01", &AT24C01 }, { "AT24C02", &AT24C02 }, { "AT24C04", &AT24C04 }, { "AT24C08", &AT24C08 },
+        { "AT24C16", &AT24C16 }, { "AT24C32", &AT24C32 }, { "AT24C64", &AT24C64 }, { "AT24C128", &AT24C128 },
+        { "AT24C256", &AT24C256 }, { "AT24C512", &AT24C512 }
+    };
+
+    for (const auto& c : chips)
+    {
+        if (0 == strcasecmp(c.name, name))
+        {
+            chip = *c.chip;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}
+
+#endif // _CHIP_NAMES_H
+
+// EOF
@@ -0,0 +1,505 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : eepromd.cpp
+// Purpose     : EEPROM Access Daemon
+// Description :
+//               Service owning one or more I2C buses and the AT24CXX devices on them, serving batched read and
+//               write requests from many clients over a Unix domain socket (see eepromd_protocol.h). Centralizing
+//               bus access removes contention between independent clients on /dev/i2c-* and lets the daemon
+//               apply the following per batch:
+//
+//               - Coalescing: consecutive overlapping or adjacent writes to one device are merged in RAM and
+//                 issued as a single write, unless a read of the affected bytes intervenes.
+//               - Read caching: reads are served through a SharedPageCache per device, which the daemon, as sole
+//                 writer, keeps coherent; other local processes may attach to the same cache read-only.
+//               - Overlapped writes: operations for different devices are executed concurrently, so the write
+//                 cycle of one device overlaps bus traffic to the others.
+//
+//               Sockets are non-blocking and replies are queued per client, so a client that stops reading its
+//               replies stalls only itself: once its backlog reaches EEPROMD_MAX_BACKLOG, its further requests are
+//               left unread until it catches up.
+//
+//               Usage: eepromd [-s socket] [-m image] -d bus:chip[:addr] [-d ...]
+//                      -s socket          socket path (default /run/eepromd.sock)
+//                      -m image           emulate all devices on a memory-mapped image instead of i2c-dev
+//                      -d bus:chip[:addr] device, indexed from 0 in order given, e.g. /dev/i2c-1:AT24C256:0
+//
+//               The shared cache of device N is named /eepromd-N.
+//
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <algorithm>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "chip_names.h"
+#include "eepromd_protocol.h"
+#include "mapped_eeprom.h"
+#include "shared_page_cache.h"
+
+using namespace PeripheralIO;
+
+struct Device
+{
+    std::unique_ptr<AT24CXX>         eeprom;
+    std::unique_ptr<SharedPageCache> cache;
+};
+
+struct Op
+{
+    EepromdRequest  req;
+    const uint8_t * data;
+    EepromdResult   result;
+    uint8_t *       read_data;
+};
+
+struct Client
+{
+    int                  fd;
+    std::vector<uint8_t> in;
+    std::vector<uint8_t> out;
+};
+
+// Unsent reply bytes at which a client's further requests are held back
+const size_t EEPROMD_MAX_BACKLOG = 4 * EEPROMD_MAX_FRAME;
+
+// Largest single cache write; merged runs may span a whole AT24C512, beyond a 16-bit length
+const size_t EEPROMD_MAX_WRITE = 0x8000;
+
+static volatile sig_atomic_t running = 1;
+
+static void onSignal(int)
+{
+    running = 0;
+}
+
+// Merged run of pending writes to one device
+struct WriteRun
+{
+    uint16_t             address;
+    std::vector<uint8_t> bytes;
+    std::vector<Op*>     ops;
+};
+
+static void flushRun(Device& dev, WriteRun& run)
+{
+    uint8_t status = EEPROMD_OK;
+
+    if (run.ops.empty())
+        return;
+
+    for (size_t done = 0; (done < run.bytes.size()) && (EEPROMD_OK == status); done += EEPROMD_MAX_WRITE)
+    {
+        size_t chunk = std::min(run.bytes.size() - done, EEPROMD_MAX_WRITE);
+
+        if (!dev.cache->write((uint16_t)(run.address + done), run.bytes.data() + done, (uint16_t)chunk))
+            status = EEPROMD_ERR_IO;
+    }
+
+    for (Op* op : run.ops)
+        op->result.status = status;
+
+    run.ops.clear();
+    run.bytes.clear();
+}
+
+// Execute one device's operations in order, coalescing writes
+static void runDevice(Device& dev, const std::vector<Op*>& ops)
+{
+    WriteRun run;
+
+    for (Op* op : ops)
+    {
+        uint32_t start = op->req.address;
+        uint32_t end   = start + op->req.len;
+
+        if (EEPROMD_OP_WRITE == op->req.op)
+        {
+            uint32_t run_end = run.address + run.bytes.size();
+
+            if (!run.ops.empty() && ((start > run_end) || (end < run.address)))
+                flushRun(dev, run);
+
+            if (run.ops.empty())
+            {
+                run.address = (uint16_t)start;
+                run.bytes.assign(op->data, op->data + op->req.len);
+            }
+            else
+            {
+                // Extend run to cover the union, then lay the later write over it
+                if (start < run.address)
+                {
+                    run.bytes.insert(run.bytes.begin(), run.address - start, 0);
+                    run.address = (uint16_t)start;
+                }
+
+                if (end > run.address + run.bytes.size())
+                    run.bytes.resize(end - run.address);
+
+                memcpy(&run.bytes[start - run.address], op->data, op->req.len);
+            }
+
+            run.ops.push_back(op);
+            continue;
+        }
+
+        // Read of bytes still pending must observe them
+        if (!run.ops.empty() && (start < run.address + run.bytes.size()) && (end > run.address))
+            flushRun(dev, run);
+
+        op->result.status = dev.cache->read(op->req.address, op->read_data, op->req.len) ? EEPROMD_OK : EEPROMD_ERR_IO;
+    }
+
+    flushRun(dev, run);
+}
+
+// Parse, execute and answer one request frame
+static std::vector<uint8_t> serveBatch(std::vector<Device>& devices, const EepromdFrame& frame, const uint8_t * payload)
+{
+    std::vector<Op>                 ops(frame.count);
+    std::vector<std::vector<Op*> >  by_device(devices.size());
+    std::vector<std::future<void> > pending;
+    std::vector<uint8_t>            read_space;
+    std::vector<uint8_t>            out;
+    size_t                          pos   = 0;
+    size_t                          reads = 0;
+
+    // First pass validates operations and sizes the read buffer
+    for (Op& op : ops)
+    {
+        op.result = EepromdResult{ EEPROMD_OK, 0, 0 };
+        op.data   = nullptr;
+
+        if (pos + sizeof(EepromdRequest) > frame.payload_len)
+        {
+            op.req            = EepromdRequest{ 0, 0, 0, 0 };
+            op.result.status  = EEPROMD_ERR_REQUEST;
+            continue;
+        }
+
+        memcpy(&op.req, payload + pos, sizeof(EepromdRequest));
+        pos += sizeof(EepromdRequest);
+
+        if (EEPROMD_OP_WRITE == op.req.op)
+        {
+            if (pos + op.req.len > frame.payload_len)
+            {
+                op.result.status = EEPROMD_ERR_REQUEST;
+                pos              = frame.payload_len;
+                continue;
+            }
+
+            op.data = payload + pos;
+            pos    += op.req.len;
+        }
+        else if (EEPROMD_OP_READ != op.req.op)
+        {
+            op.result.status = EEPROMD_ERR_REQUEST;
+            continue;
+        }
+
+        if (op.req.device >= devices.size())
+            op.result.status = EEPROMD_ERR_DEVICE;
+        else if ((uint32_t)op.req.address + op.req.len > devices[op.req.device].eeprom->size())
+            op.result.status = EEPROMD_ERR_RANGE;
+        else if (EEPROMD_OP_READ == op.req.op)
+            reads += op.req.len;
+    }
+
+    read_space.resize(reads);
+    reads = 0;
+
+    for (Op& op : ops)
+    {
+        if (EEPROMD_OK != op.result.status)
+            continue;
+
+        if (EEPROMD_OP_READ == op.req.op)
+        {
+            op.read_data = read_space.data() + reads;
+            reads       += op.req.len;
+        }
+
+        by_device[op.req.device].push_back(&op);
+    }
+
+    // Devices proceed concurrently; the bus mutex in the HAL interleaves their transfers
+    for (size_t d = 0; d < devices.size(); d++)
+    {
+        if (!by_device[d].empty())
+            pending.push_back(std::async(std::launch::async, runDevice, std::ref(devices[d]), std::cref(by_device[d])));
+    }
+
+    for (auto& p : pending)
+        p.get();
+
+    out.resize(sizeof(EepromdFrame));
+
+    for (Op& op : ops)
+    {
+        bool with_data = (EEPROMD_OK == op.result.status) && (EEPROMD_OP_READ == op.req.op);
+
+        op.result.len = with_data ? op.req.len : 0;
+        out.insert(out.end(), (uint8_t*)&op.result, (uint8_t*)&op.result + sizeof(EepromdResult));
+
+        if (with_data)
+            out.insert(out.end(), op.read_data, op.read_data + op.req.len);
+    }
+
+    EepromdFrame reply{ EEPROMD_MAGIC, frame.count, 0, (uint32_t)(out.size() - sizeof(EepromdFrame)) };
+    memcpy(out.data(), &reply, sizeof(reply));
+
+    return out;
+}
+
+// Send as much queued reply data as the socket accepts; false for a broken connection
+static bool sendPending(Client& client)
+{
+    size_t sent = 0;
+
+    while (sent < client.out.size())
+    {
+        ssize_t n = send(client.fd, client.out.data() + sent, client.out.size() - sent, MSG_NOSIGNAL);
+
+        if (n < 0)
+        {
+            if (EINTR == errno)
+                continue;
+
+            if ((EAGAIN != errno) && (EWOULDBLOCK != errno))
+                return false;
+
+            break;
+        }
+
+        sent += (size_t)n;
+    }
+
+    client.out.erase(client.out.begin(), client.out.begin() + sent);
+    return true;
+}
+
+// Consume complete frames from a client's buffer while its reply backlog allows; false drops the client
+static bool serveClient(std::vector<Device>& devices, Client& client)
+{
+    EepromdFrame frame;
+
+    if (!sendPending(client))
+        return false;
+
+    while ((client.out.size() < EEPROMD_MAX_BACKLOG) && (client.in.size() >= sizeof(EepromdFrame)))
+    {
+        memcpy(&frame, client.in.data(), sizeof(frame));
+
+        if ((EEPROMD_MAGIC != frame.magic) || (frame.count > EEPROMD_MAX_OPS) || (frame.payload_len > EEPROMD_MAX_FRAME))
+            return false;
+
+        if (client.in.size() < sizeof(frame) + frame.payload_len)
+            return true;
+
+        std::vector<uint8_t> reply = serveBatch(devices, frame, client.in.data() + sizeof(frame));
+
+        client.in.erase(client.in.begin(), client.in.begin() + sizeof(frame) + frame.payload_len);
+        client.out.insert(client.out.end(), reply.begin(), reply.end());
+
+        if (!sendPending(client))
+            return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char ** argv)
+{
+    std::string                                  socket_path = "/run/eepromd.sock";
+    std::string                                  image;
+    std::string                                  error;
+    std::vector<std::string>                     specs;
+    std::map<std::string, std::unique_ptr<HAL::I2C> > buses;
+    std::unique_ptr<HAL::MappedEeprom>           emulator;
+    std::vector<Device>                          devices;
+    std::vector<Client>                          clients;
+    struct sockaddr_un                           sun;
+    int                                          listener;
+    int                                          opt;
+
+    while ((opt = getopt(argc, argv, "s:m:d:")) != -1)
+    {
+        if ('s' == opt)
+            socket_path = optarg;
+        else if ('m' == opt)
+            image = optarg;
+        else if ('d' == opt)
+            specs.push_back(optarg);
+        else
+            return 2;
+    }
+
+    if (specs.empty() || (specs.size() > 255) || (socket_path.size() >= sizeof(sun.sun_path)))
+    {
+        fprintf(stderr, "usage: %s [-s socket] [-m image] -d bus:chip[:addr] [-d ...]\n", argv[0]);
+        return 2;
+    }
+
+    if (!image.empty())
+        emulator.reset(new HAL::MappedEeprom(image.c_str()));
+
+    devices.resize(specs.size());
+
+    for (size_t i = 0; i < specs.size(); i++)
+    {
+        std::string bus   = specs[i].substr(0, specs[i].find(':'));
+        std::string rest  = (specs[i].find(':') == std::string::npos) ? "" : specs[i].substr(bus.size() + 1);
+        std::string name  = rest.substr(0, rest.find(':'));
+        uint8_t     addr  = (rest.find(':') == std::string::npos) ? 0 : (uint8_t)strtoul(rest.c_str() + name.size() + 1, nullptr, 0);
+        uint32_t    chip;
+
+        if (!chipByName(name.c_str(), chip))
+        {
+            fprintf(stderr, "bad device %s\n", specs[i].c_str());
+            return 2;
+        }
+
+        if (emulator && !emulator->addDevice(chip, addr))
+        {
+            fprintf(stderr, "conflicting device %s\n", specs[i].c_str());
+            return 2;
+        }
+
+        if (!buses.count(bus))
+            buses[bus].reset(emulator ? new HAL::I2C(*emulator) : new HAL::I2C(bus.c_str()));
+
+        devices[i].eeprom.reset(new AT24CXX(*buses[bus], chip, addr));
+    }
+
+    if (emulator && !emulator->open(error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    for (size_t i = 0; i < devices.size(); i++)
+    {
+        std::string cache_name = "/eepromd-" + std::to_string(i);
+
+        devices[i].eeprom->init();
+
+        // A previous instance's cache may predate writes made while the daemon was down
+        SharedPageCache::unlink(cache_name.c_str());
+        devices[i].cache.reset(new SharedPageCache(*devices[i].eeprom, cache_name.c_str()));
+
+        if (!devices[i].cache->open(error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+    }
+
+    for (auto& bus : buses)
+    {
+        if (!bus.second->isOpen())
+        {
+            fprintf(stderr, "cannot open %s\n", bus.first.c_str());
+            return 1;
+        }
+    }
+
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    memset(&sun, 0, sizeof(sun));
+    sun.sun_family = AF_UNIX;
+    strncpy(sun.sun_path, socket_path.c_str(), sizeof(sun.sun_path) - 1);
+    unlink(socket_path.c_str());
+
+    if ((listener < 0) || (bind(listener, (struct sockaddr*)&sun, sizeof(sun)) < 0) || (listen(listener, 16) < 0))
+    {
+        fprintf(stderr, "cannot listen on %s: %s\n", socket_path.c_str(), strerror(errno));
+        return 1;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    while (running)
+    {
+        std::vector<struct pollfd> fds(1 + clients.size());
+
+        fds[0] = { listener, POLLIN, 0 };
+
+        // A client with a full backlog is not read from until it drains its replies
+        for (size_t i = 0; i < clients.size(); i++)
+        {
+            short events = (clients[i].out.size() < EEPROMD_MAX_BACKLOG) ? POLLIN : 0;
+
+            fds[i + 1] = { clients[i].fd, (short)(events | (clients[i].out.empty() ? 0 : POLLOUT)), 0 };
+        }
+
+        if (poll(fds.data(), fds.size(), 500) < 0)
+            continue;
+
+        if (fds[0].revents & POLLIN)
+        {
+            int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+
+            if (fd >= 0)
+                clients.push_back(Client{ fd, {}, {} });
+        }
+
+        for (size_t i = fds.size() - 1; i >= 1; i--)
+        {
+            Client& client = clients[i - 1];
+            uint8_t buf[4096];
+            ssize_t n;
+            bool    keep = true;
+
+            // Draining replies may lift the backlog limit on frames already received
+            if (fds[i].revents & POLLOUT)
+                keep = serveClient(devices, client);
+
+            if (keep && (fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+            {
+                n = recv(client.fd, buf, sizeof(buf), 0);
+
+                if (n > 0)
+                {
+                    client.in.insert(client.in.end(), buf, buf + n);
+                    keep = serveClient(devices, client);
+                }
+                else if ((n == 0) || ((EINTR != errno) && (EAGAIN != errno) && (EWOULDBLOCK != errno)))
+                {
+                    keep = false;
+                }
+            }
+
+            if (!keep)
+            {
+                close(client.fd);
+                clients.erase(clients.begin() + (i - 1));
+            }
+        }
+    }
+
+    for (Client& client : clients)
+        close(client.fd);
+
+    close(listener);
+    unlink(socket_path.c_str());
+
+    return 0;
+}
+
+// EOF
@@ -0,0 +1,200 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : eepromd_client.cpp
+// Purpose     : EEPROM Access Daemon Client
+// Description : This source file implements header file eepromd_client.h.
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "eepromd_client.h"
+
+namespace PeripheralIO
+{
+
+EepromdClient::EepromdClient()
+: _fd(-1)
+, _count(0)
+{ }
+
+EepromdClient::~EepromdClient()
+{
+    if (_fd >= 0)
+        close(_fd);
+}
+
+bool EepromdClient::connect(const char * path)
+{
+    struct sockaddr_un sun;
+
+    if (strlen(path) >= sizeof(sun.sun_path))
+        return false;
+
+    if (_fd >= 0)
+        close(_fd);
+
+    _fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (_fd < 0)
+        return false;
+
+    memset(&sun, 0, sizeof(sun));
+    sun.sun_family = AF_UNIX;
+    strncpy(sun.sun_path, path, sizeof(sun.sun_path) - 1);
+
+    if (::connect(_fd, (struct sockaddr*)&sun, sizeof(sun)) < 0)
+    {
+        close(_fd);
+        _fd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+bool EepromdClient::read(uint8_t device, uint16_t address, uint8_t * vals, uint16_t len)
+{
+    return queueRead(device, address, vals, len) && submit();
+}
+
+bool EepromdClient::write(uint8_t device, uint16_t address, const uint8_t * vals, uint16_t len)
+{
+    return queueWrite(device, address, vals, len) && submit();
+}
+
+bool EepromdClient::queueRead(uint8_t device, uint16_t address, uint8_t * vals, uint16_t len)
+{
+    EepromdRequest req{ EEPROMD_OP_READ, device, address, len };
+
+    if (_count >= EEPROMD_MAX_OPS)
+        return false;
+
+    _payload.insert(_payload.end(), (uint8_t*)&req, (uint8_t*)&req + sizeof(req));
+    _read_dest.push_back(vals);
+    _count++;
+
+    return true;
+}
+
+bool EepromdClient::queueWrite(uint8_t device, uint16_t address, const uint8_t * vals, uint16_t len)
+{
+    EepromdRequest req{ EEPROMD_OP_WRITE, device, address, len };
+
+    if ((_count >= EEPROMD_MAX_OPS) || (_payload.size() + sizeof(req) + len > EEPROMD_MAX_FRAME))
+        return false;
+
+    _payload.insert(_payload.end(), (uint8_t*)&req, (uint8_t*)&req + sizeof(req));
+    _payload.insert(_payload.end(), vals, vals + len);
+    _read_dest.push_back(nullptr);
+    _count++;
+
+    return true;
+}
+
+bool EepromdClient::submit(std::vector<uint8_t> * status)
+{
+    EepromdFrame         frame{ EEPROMD_MAGIC, _count, 0, (uint32_t)_payload.size() };
+    EepromdResult        result{ EEPROMD_OK, 0, 0 };
+    std::vector<uint8_t> scratch;
+    bool                 linked = (_fd >= 0);
+    bool                 ok     = true;
+
+    if (status)
+        status->clear();
+
+    linked = linked && sendAll((uint8_t*)&frame, sizeof(frame)) && sendAll(_payload.data(), _payload.size());
+    linked = linked && recvAll((uint8_t*)&frame, sizeof(frame));
+    linked = linked && (EEPROMD_MAGIC == frame.magic) && (frame.count == _count);
+
+    // Every result is consumed, failed or not, to keep the stream aligned
+    for (uint16_t i = 0; linked && (i < _count); i++)
+    {
+        uint8_t * dest = _read_dest[i];
+
+        linked = recvAll((uint8_t*)&result, sizeof(result));
+
+        if (linked && result.len)
+        {
+            if (!dest)
+            {
+                scratch.resize(result.len);
+                dest = scratch.data();
+            }
+
+            linked = recvAll(dest, result.len);
+        }
+
+        if (status && linked)
+            status->push_back(result.status);
+
+        if (EEPROMD_OK != result.status)
+            ok = false;
+    }
+
+    // A broken stream cannot be resynchronized
+    if (!linked && (_fd >= 0))
+    {
+        close(_fd);
+        _fd = -1;
+    }
+
+    _payload.clear();
+    _read_dest.clear();
+    _count = 0;
+
+    return linked && ok;
+}
+
+// Private: Send whole buffer, retrying short writes
+bool EepromdClient::sendAll(const uint8_t * data, size_t len)
+{
+    while (len)
+    {
+        ssize_t n = send(_fd, data, len, MSG_NOSIGNAL);
+
+        if (n < 0)
+        {
+            if (EINTR == errno)
+                continue;
+
+            return false;
+        }
+
+        data += n;
+        len  -= (size_t)n;
+    }
+
+    return true;
+}
+
+// Private: Receive exactly len bytes
+bool EepromdClient::recvAll(uint8_t * data, size_t len)
+{
+    while (len)
+    {
+        ssize_t n = recv(_fd, data, len, 0);
+
+        if (n <= 0)
+        {
+            if ((n < 0) && (EINTR == errno))
+                continue;
+
+            return false;
+        }
+
+        data += n;
+        len  -= (size_t)n;
+    }
+
+    return true;
+}
+
+}
+
+// EOF
@@ -0,0 +1,97 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : eepromd_client.h
+// Purpose     : EEPROM Access Daemon Client
+// Description :
+//               Client for eepromd. Single reads and writes are sent as one-operation batches; for throughput,
+//               operations are queued with queueRead() and queueWrite() and sent together with submit(), which
+//               lets the daemon coalesce writes and overlap devices' write cycles within the batch.
+//
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : eepromd_protocol.h
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _EEPROMD_CLIENT_H
+#define _EEPROMD_CLIENT_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "eepromd_protocol.h"
+
+namespace PeripheralIO
+{
+
+class EepromdClient
+{
+    public:
+        EepromdClient();
+
+        ~EepromdClient();
+
+        EepromdClient(const EepromdClient&) = delete;
+        EepromdClient& operator=(const EepromdClient&) = delete;
+
+        /**
+         * @brief Connect to daemon
+         * @param path Socket path of daemon
+         * @return False if connection fails, true otherwise
+        */
+        bool connect(const char * path);
+
+        /**
+         * @brief Read bytes from a device
+         * @param device Device index in daemon configuration
+         * @param address Starting address
+         * @param vals Pointer to array into which data will be placed
+         * @param len Number of bytes to read
+         * @return False for transport or device error, true otherwise
+        */
+        bool read(uint8_t device, uint16_t address, uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Write bytes to a device
+         * @param device Device index in daemon configuration
+         * @param address Starting address
+         * @param vals Pointer to data to write
+         * @param len Number of bytes to write
+         * @return False for transport or device error, true otherwise
+        */
+        bool write(uint8_t device, uint16_t address, const uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Queue a read for the next submit(); vals is filled in by submit()
+         * @return False if the batch is full, true otherwise
+        */
+        bool queueRead(uint8_t device, uint16_t address, uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Queue a write for the next submit(); data is copied
+         * @return False if the batch is full, true otherwise
+        */
+        bool queueWrite(uint8_t device, uint16_t address, const uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Send queued operations as one batch and wait for their results
+         * @param status Optional out: per-operation status, in queue order
+         * @return False for transport error or any failed operation, true otherwise
+        */
+        bool submit(std::vector<uint8_t> * status=nullptr);
+
+    private:
+        bool sendAll(const uint8_t * data, size_t len);
+        bool recvAll(uint8_t * data, size_t len);
+
+        int                    _fd;
+        uint16_t               _count;
+        std::vector<uint8_t>   _payload;
+        std::vector<uint8_t *> _read_dest;
+};
+
+}
+
+#endif // _EEPROMD_CLIENT_H
+
+// EOF
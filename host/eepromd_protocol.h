@@ -0,0 +1,82 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : eepromd_protocol.h
+// Purpose     : EEPROM Access Daemon Wire Protocol
+// Description :
+//               Binary request/response framing shared by eepromd and its clients over a Unix stream socket. A
+//               request frame carries a batch of operations, each addressed to a device by its index in the
+//               daemon's configuration; write operations are followed by their data. The response frame carries
+//               one result per operation, in order, each read result followed by its data. All fields are
+//               little-endian.
+//
+//               Operations in a batch are applied in order per device; operations on different devices may be
+//               carried out concurrently.
+//
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : N/A
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _EEPROMD_PROTOCOL_H
+#define _EEPROMD_PROTOCOL_H
+
+#include <stdint.h>
+
+namespace PeripheralIO
+{
+
+const uint32_t EEPROMD_MAGIC     = 0x31445045; // "EPD1"
+const uint16_t EEPROMD_MAX_OPS   = 256;        // operations per batch
+const uint32_t EEPROMD_MAX_FRAME = 1u << 20;   // payload bytes per frame
+
+enum EepromdOp : uint8_t
+{
+    EEPROMD_OP_READ  = 1,
+    EEPROMD_OP_WRITE = 2
+};
+
+enum EepromdStatus : uint8_t
+{
+    EEPROMD_OK          = 0,
+    EEPROMD_ERR_DEVICE  = 1, // unknown device index
+    EEPROMD_ERR_RANGE   = 2, // request exceeds device
+    EEPROMD_ERR_IO      = 3, // I2C error
+    EEPROMD_ERR_REQUEST = 4  // malformed operation
+};
+
+#pragma pack(push, 1)
+
+// Frame header for both directions; payload_len bytes of operations or results follow
+struct EepromdFrame
+{
+    uint32_t magic;
+    uint16_t count;
+    uint16_t reserved;
+    uint32_t payload_len;
+};
+
+// Request operation; a write is followed by len data bytes
+struct EepromdRequest
+{
+    uint8_t  op;
+    uint8_t  device;
+    uint16_t address;
+    uint16_t len;
+};
+
+// Operation result; a successful read is followed by len data bytes
+struct EepromdResult
+{
+    uint8_t  status;
+    uint8_t  reserved;
+    uint16_t len;
+};
+
+#pragma pack(pop)
+
+}
+
+#endif // _EEPROMD_PROTOCOL_H
+
+// EOF
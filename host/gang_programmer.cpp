@@ -0,0 +1,220 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : gang_programmer.cpp
+// Purpose     : AT24CXX Parallel Gang Programmer
+// Description : This source file implements header file gang_programmer.h.
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <map>
+#include <thread>
+#include "gang_programmer.h"
+
+namespace PeripheralIO
+{
+
+// Bytes read back, compared and verified per step; a multiple of every page size
+const uint16_t GANG_BLOCK_SIZE = 1024;
+
+
+GangProgrammer::GangProgrammer(uint32_t chip)
+: _image(nullptr)
+, _image_len(0)
+, _chip(chip)
+{ }
+
+GangProgrammer::~GangProgrammer()
+{
+    if (_image)
+        munmap((void*)_image, _image_len);
+}
+
+bool GangProgrammer::loadImage(const char * path, std::string& error)
+{
+    struct stat st;
+    void*       map;
+    int         fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        error = std::string("cannot open ") + path + ": " + strerror(errno);
+        return false;
+    }
+
+    if ((fstat(fd, &st) < 0) || (0 == st.st_size))
+    {
+        error = std::string("empty or unreadable image ") + path;
+        close(fd);
+        return false;
+    }
+
+    map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (MAP_FAILED == map)
+    {
+        error = std::string("cannot map ") + path + ": " + strerror(errno);
+        return false;
+    }
+
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+    if (_image)
+        munmap((void*)_image, _image_len);
+
+    _image     = (const uint8_t*)map;
+    _image_len = (size_t)st.st_size;
+
+    return true;
+}
+
+void GangProgrammer::addTarget(const std::string& bus, uint8_t chip_addr)
+{
+    _targets.push_back(GangTarget{ bus, chip_addr });
+}
+
+std::vector<GangResult> GangProgrammer::run(uint16_t offset, bool verify)
+{
+    std::vector<GangResult>                      results(_targets.size());
+    std::map<std::string, std::vector<size_t> >  buses;
+    std::vector<std::thread>                     workers;
+
+    for (size_t i = 0; i < _targets.size(); i++)
+    {
+        results[i].bus           = _targets[i].bus;
+        results[i].chip_addr     = _targets[i].chip_addr;
+        results[i].ok            = false;
+        results[i].pages_written = 0;
+        results[i].pages_skipped = 0;
+        results[i].fail_address  = -1;
+        results[i].elapsed_ms    = 0;
+
+        buses[_targets[i].bus].push_back(i);
+    }
+
+    for (auto& bus : buses)
+    {
+        workers.emplace_back(&GangProgrammer::programBus, this, bus.first, bus.second, offset, verify,
+                             std::ref(results));
+    }
+
+    for (auto& worker : workers)
+        worker.join();
+
+    return results;
+}
+
+// Private: Worker body; programs every target on one bus in turn
+void GangProgrammer::programBus(const std::string& bus, const std::vector<size_t>& targets, uint16_t offset,
+                                bool verify, std::vector<GangResult>& results)
+{
+    HAL::I2C i2c(bus.c_str());
+
+    i2c.init();
+
+    for (size_t index : targets)
+    {
+        GangResult& result = results[index];
+        auto        start  = std::chrono::steady_clock::now();
+
+        if (!i2c.isOpen())
+        {
+            result.error = "cannot open " + bus;
+            continue;
+        }
+
+        AT24CXX eeprom(i2c, _chip, _targets[index].chip_addr);
+        eeprom.init();
+
+        programDevice(eeprom, offset, verify, result);
+
+        result.elapsed_ms = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+// Private: Compare, write differing pages and verify one block at a time
+void GangProgrammer::programDevice(AT24CXX& eeprom, uint16_t offset, bool verify, GangResult& result)
+{
+    std::vector<uint8_t> readback(GANG_BLOCK_SIZE);
+    uint16_t             page_size = eeprom.pageSize();
+    size_t               pos;
+    uint16_t             block;
+    uint16_t             chunk;
+    uint16_t             addr;
+
+    if ((uint32_t)offset + _image_len > eeprom.size())
+    {
+        result.error = "image does not fit device";
+        return;
+    }
+
+    for (pos = 0; pos < _image_len; pos += block)
+    {
+        block = (uint16_t)(((_image_len - pos) < GANG_BLOCK_SIZE) ? (_image_len - pos) : GANG_BLOCK_SIZE);
+        addr  = (uint16_t)(offset + pos);
+
+        if (!eeprom.read(addr, readback.data(), block))
+        {
+            result.error = "read failed";
+            return;
+        }
+
+        for (uint16_t p = 0; p < block; p += chunk)
+        {
+            chunk = (uint16_t)(page_size - ((addr + p) % page_size));
+
+            if (chunk > (block - p))
+                chunk = block - p;
+
+            if (0 == memcmp(&readback[p], &_image[pos + p], chunk))
+            {
+                result.pages_skipped++;
+                continue;
+            }
+
+            if (!eeprom.write((uint16_t)(addr + p), (uint8_t*)&_image[pos + p], chunk))
+            {
+                result.error = "write failed";
+                result.fail_address = addr + p;
+                return;
+            }
+
+            result.pages_written++;
+        }
+
+        if (!verify)
+            continue;
+
+        if (!eeprom.read(addr, readback.data(), block))
+        {
+            result.error = "verify read failed";
+            return;
+        }
+
+        for (uint16_t i = 0; i < block; i++)
+        {
+            if (readback[i] != _image[pos + i])
+            {
+                result.error        = "verify mismatch";
+                result.fail_address = addr + i;
+                return;
+            }
+        }
+    }
+
+    result.ok = true;
+}
+
+}
+
+// EOF
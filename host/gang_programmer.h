@@ -0,0 +1,103 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : gang_programmer.h
+// Purpose     : AT24CXX Parallel Gang Programmer
+// Description :
+//               Programs one EEPROM image into many AT24CXX devices at once for end-of-line stations. The image is
+//               memory-mapped read-only and shared by every worker; one worker thread is started per I2C bus, so
+//               devices on separate adapters are programmed fully in parallel and station time approaches that
+//               of a single device.
+//
+//               Each worker proceeds block by block. A block is first read back and only the pages that differ
+//               from the image are written, which makes reprogramming of partially or previously programmed
+//               boards cheap; the block is then read back and verified before the next block is started, so a
+//               failing device is abandoned early. Results are reported per device.
+//
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Hosted Linux HAL (host/hal.h)
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _GANG_PROGRAMMER_H
+#define _GANG_PROGRAMMER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "at24cxx.h"
+
+namespace PeripheralIO
+{
+
+struct GangTarget
+{
+    std::string bus;
+    uint8_t     chip_addr;
+};
+
+struct GangResult
+{
+    std::string bus;
+    uint8_t     chip_addr;
+    bool        ok;
+    uint32_t    pages_written;
+    uint32_t    pages_skipped;
+    int32_t     fail_address; // failed write or first verify mismatch, -1 when neither occurred
+    uint32_t    elapsed_ms;
+    std::string error;
+};
+
+class GangProgrammer
+{
+    public:
+       /**
+        * @brief Constructor for GangProgrammer object
+        * @param chip Defined const value for chip (e.g. PeripheralIO::AT24C256)
+       */
+        explicit GangProgrammer(uint32_t chip);
+
+        ~GangProgrammer();
+
+        GangProgrammer(const GangProgrammer&) = delete;
+        GangProgrammer& operator=(const GangProgrammer&) = delete;
+
+        /**
+         * @brief Memory-map the image to be programmed
+         * @param path Path of binary image file
+         * @param error Out: description of failure
+         * @return False if image cannot be mapped or is empty, true otherwise
+        */
+        bool loadImage(const char * path, std::string& error);
+
+        /**
+         * @brief Add device to be programmed
+         * @param bus Path of i2c-dev device, e.g. "/dev/i2c-1"
+         * @param chip_addr Externally biased address of chip
+        */
+        void addTarget(const std::string& bus, uint8_t chip_addr=0);
+
+        /**
+         * @brief Program all targets, one worker thread per bus
+         * @param offset Device address at which image is placed
+         * @param verify Read back and compare each block after writing
+         * @return Result per target, in order of addition
+        */
+        std::vector<GangResult> run(uint16_t offset=0, bool verify=true);
+
+    private:
+        void programBus(const std::string& bus, const std::vector<size_t>& targets, uint16_t offset, bool verify,
+                        std::vector<GangResult>& results);
+        void programDevice(AT24CXX& eeprom, uint16_t offset, bool verify, GangResult& result);
+
+        std::vector<GangTarget> _targets;
+        const uint8_t *         _image;
+        size_t                  _image_len;
+        uint32_t                _chip;
+};
+
+}
+
+#endif // _GANG_PROGRAMMER_H
+
+// EOF
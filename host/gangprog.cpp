@@ -0,0 +1,104 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : gangprog.cpp
+// Purpose     : AT24CXX Gang Programming Station Tool
+// Description :
+//               Command line front end to GangProgrammer.
+//
+//               Usage: gangprog [-o offset] [-n] <image> <chip> <bus[:addr]>...
+//                      -o offset   device address at which the image is placed (default 0)
+//                      -n          skip verification
+//                      chip        AT24C01 ... AT24C512
+//                      bus[:addr]  i2c-dev path and optional external address bias, e.g. /dev/i2c-3:1
+//
+//               Exit status is zero only when every device was programmed and verified.
+//
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "chip_names.h"
+#include "gang_programmer.h"
+
+using namespace PeripheralIO;
+
+int main(int argc, char ** argv)
+{
+    std::string error;
+    uint32_t    chip;
+    uint16_t    offset = 0;
+    bool        verify = true;
+    bool        all_ok = true;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "o:n")) != -1)
+    {
+        if ('o' == opt)
+            offset = (uint16_t)strtoul(optarg, nullptr, 0);
+        else if ('n' == opt)
+            verify = false;
+        else
+            return 2;
+    }
+
+    if ((argc - optind) < 3)
+    {
+        fprintf(stderr, "usage: %s [-o offset] [-n] <image> <chip> <bus[:addr]>...\n", argv[0]);
+        return 2;
+    }
+
+    if (!chipByName(argv[optind + 1], chip))
+    {
+        fprintf(stderr, "unknown chip %s\n", argv[optind + 1]);
+        return 2;
+    }
+
+    GangProgrammer programmer(chip);
+
+    if (!programmer.loadImage(argv[optind], error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    for (int i = optind + 2; i < argc; i++)
+    {
+        std::string target(argv[i]);
+        size_t      colon = target.rfind(':');
+        uint8_t     addr  = 0;
+
+        if (colon != std::string::npos)
+        {
+            addr   = (uint8_t)strtoul(target.c_str() + colon + 1, nullptr, 0);
+            target = target.substr(0, colon);
+        }
+
+        programmer.addTarget(target, addr);
+    }
+
+    for (const GangResult& r : programmer.run(offset, verify))
+    {
+        printf("%-16s addr %u  %-4s  written %5u  skipped %5u  %6u ms", r.bus.c_str(), r.chip_addr,
+               r.ok ? "OK" : "FAIL", r.pages_written, r.pages_skipped, r.elapsed_ms);
+
+        if (!r.ok)
+        {
+            printf("  %s", r.error.c_str());
+
+            if (r.fail_address >= 0)
+                printf(" at 0x%04X", (unsigned)r.fail_address);
+        }
+
+        printf("\n");
+        all_ok = all_ok && r.ok;
+    }
+
+    return all_ok ? 0 : 1;
+}
+
+// EOF
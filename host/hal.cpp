@@ -0,0 +1,199 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : hal.cpp
+// Purpose     : Hosted Linux Hardware Abstraction Layer for AT24CXX
+// Description : This source file implements header file hal.h.
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "hal.h"
+#include "mapped_eeprom.h"
+
+namespace HAL
+{
+
+static std::atomic<bool>     virtual_clock(false);
+static std::atomic<uint64_t> virtual_us(0);
+static std::function<void(uint32_t)> delay_hook;
+
+void delay_ms(uint32_t ms)
+{
+    if (delay_hook)
+        delay_hook(ms);
+    else if (virtual_clock)
+        virtual_us += (uint64_t)ms * 1000;
+    else
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// Private: 64-bit microsecond time base from which both 32-bit clocks wrap naturally
+static uint64_t nowUs()
+{
+    using namespace std::chrono;
+
+    if (virtual_clock)
+        return virtual_us.load();
+
+    return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t millis()
+{
+    return (uint32_t)(nowUs() / 1000);
+}
+
+uint32_t micros()
+{
+    return (uint32_t)nowUs();
+}
+
+void setVirtualClock(bool enable)
+{
+    virtual_clock = enable;
+}
+
+void advanceClock(uint32_t us)
+{
+    virtual_us += us;
+}
+
+void setDelayHook(std::function<void(uint32_t ms)> hook)
+{
+    delay_hook = hook;
+}
+
+
+I2C::I2C(const char * device)
+: _fd(-1)
+, _emulator(nullptr)
+, _bus_hz(0)
+, _bus_time_us(0)
+{
+    strncpy(_device, device, sizeof(_device) - 1);
+    _device[sizeof(_device) - 1] = 0;
+}
+
+I2C::I2C(MappedEeprom& emulator)
+: _fd(-1)
+, _emulator(&emulator)
+, _bus_hz(0)
+, _bus_time_us(0)
+{
+    _device[0] = 0;
+}
+
+I2C::~I2C()
+{
+    if (_fd >= 0)
+        close(_fd);
+}
+
+void I2C::init()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+
+    if ((_fd < 0) && !_emulator)
+        _fd = open(_device, O_RDWR | O_CLOEXEC);
+}
+
+int I2C::write(uint8_t addr, uint8_t reg, uint8_t * vals, uint16_t len)
+{
+    return transfer(addr, &reg, 1, vals, len, false);
+}
+
+int I2C::write(uint8_t addr, uint16_t reg, uint8_t * vals, uint16_t len)
+{
+    uint8_t be[2] = { (uint8_t)(reg >> 8), (uint8_t)(reg & 0xFF) };
+    return transfer(addr, be, 2, vals, len, false);
+}
+
+int I2C::writeRead(uint8_t addr, uint8_t reg, uint8_t * vals, uint16_t len)
+{
+    return transfer(addr, &reg, 1, vals, len, true);
+}
+
+int I2C::writeRead(uint8_t addr, uint16_t reg, uint8_t * vals, uint16_t len)
+{
+    uint8_t be[2] = { (uint8_t)(reg >> 8), (uint8_t)(reg & 0xFF) };
+    return transfer(addr, be, 2, vals, len, true);
+}
+
+// Private: Issue register pointer write followed by data write, or by repeated-start read
+int I2C::transfer(uint8_t addr, const uint8_t * reg, uint8_t reg_len, uint8_t * vals, uint16_t len, bool read)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    std::vector<uint8_t>        out;
+    struct i2c_msg              msgs[2];
+    struct i2c_rdwr_ioctl_data  xfer;
+
+    if (_emulator)
+    {
+        uint32_t bytes = 1 + reg_len + (read ? 1 + len : len);
+        int      result;
+
+        // Nine clocks per byte plus start and stop; an acknowledged transfer is charged before the write cycle
+        // begins at stop, while a NACKed address ends the transfer after one byte
+        if (!_bus_hz || _emulator->ready(addr))
+        {
+            chargeBus(bytes);
+            return _emulator->transfer(addr, reg, reg_len, vals, len, read);
+        }
+
+        result = _emulator->transfer(addr, reg, reg_len, vals, len, read);
+        chargeBus(1);
+
+        return result;
+    }
+
+    out.assign(reg, reg + reg_len);
+
+    if (_fd < 0)
+        return -1;
+
+    if (!read)
+        out.insert(out.end(), vals, vals + len);
+
+    msgs[0].addr  = addr;
+    msgs[0].flags = 0;
+    msgs[0].len   = (uint16_t)out.size();
+    msgs[0].buf   = out.data();
+
+    msgs[1].addr  = addr;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len   = len;
+    msgs[1].buf   = vals;
+
+    xfer.msgs  = msgs;
+    xfer.nmsgs = read ? 2 : 1;
+
+    return (ioctl(_fd, I2C_RDWR, &xfer) < 0) ? -1 : 0;
+}
+
+// Private: Advance virtual clock by the duration of an emulated transfer
+void I2C::chargeBus(uint32_t bytes)
+{
+    uint32_t us;
+
+    if (!_bus_hz)
+        return;
+
+    us = (uint32_t)((bytes * 9 + 2) * 1000000ull / _bus_hz);
+    _bus_time_us += us;
+    advanceClock(us);
+}
+
+}
+
+// EOF
@@ -0,0 +1,156 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : hal.h
+// Purpose     : Hosted Linux Hardware Abstraction Layer for AT24CXX
+// Description :
+//               Implementation of the HAL contract required by at24cxx.h for Linux hosts, so that the driver and
+//               its layered modules can run on production stations and gateways. I2C transfers are issued through
+//               the i2c-dev interface (/dev/i2c-N) using combined I2C_RDWR transactions; each transaction holds a
+//               per-bus mutex, so several threads may share one bus object and interleave their transfers between
+//               each other's write cycle delays. GPIO is a no-op, as hosted adapters rarely expose the WP pin.
+//
+//               An I2C object may instead be bound to a MappedEeprom, which emulates devices on a memory-mapped
+//               image file (see mapped_eeprom.h). For emulated runs a virtual clock may be selected, whereupon
+//               delay_ms() advances time instantly rather than sleeping, and firmware runs at memory speed. Emulated
+//               buses may also charge each transfer's duration at a given SCL rate to the virtual clock, and a delay
+//               hook may replace the driver's fixed write cycle delays, e.g. with acknowledge polling.
+//
+//               Unlike MCU Wire buffers, i2c-dev imposes no small transfer limit, so this HAL raises
+//               AT24CXX_I2C_WRITE_MAX and the driver writes whole pages per write cycle.
+//
+//               Place this directory on the include path ahead of any target HAL when building host tools.
+//
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : linux/i2c-dev.h
+//               Custom   : N/A
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _HAL_H
+#define _HAL_H
+
+#include <stdint.h>
+#include <functional>
+#include <mutex>
+
+#ifndef OUTPUT
+#define OUTPUT 1
+#endif
+
+#define AT24CXX_I2C_WRITE_MAX 256
+
+namespace HAL
+{
+
+class MappedEeprom;
+
+/**
+ * @brief Block the calling thread, or advance the virtual clock when selected
+ * @param ms Delay in milliseconds
+*/
+void delay_ms(uint32_t ms);
+
+/**
+ * @brief Milliseconds elapsed on the monotonic or virtual clock
+*/
+uint32_t millis();
+
+/**
+ * @brief Microseconds elapsed on the monotonic or virtual clock
+*/
+uint32_t micros();
+
+/**
+ * @brief Select virtual clock, under which delays complete instantly and only advance time
+ * @param enable True for virtual clock, false for real time
+*/
+void setVirtualClock(bool enable);
+
+/**
+ * @brief Advance the virtual clock without delay semantics, e.g. to model bus transfer time
+ * @param us Microseconds to advance
+*/
+void advanceClock(uint32_t us);
+
+/**
+ * @brief Replace delay_ms() behavior, e.g. to model acknowledge polling in emulated runs
+ * @param hook Function receiving each requested delay in place of the default; empty to restore default
+*/
+void setDelayHook(std::function<void(uint32_t ms)> hook);
+
+class GPIO
+{
+    public:
+        explicit GPIO(uint8_t pin) : _pin(pin) { }
+
+        void pinMode(uint8_t mode) const { (void)mode; }
+
+        void digitalWrite(bool level) const { (void)level; }
+
+    private:
+        uint8_t _pin;
+};
+
+class I2C
+{
+    public:
+       /**
+        * @brief Constructor for I2C object
+        * @param device Path of i2c-dev character device, e.g. "/dev/i2c-1"
+       */
+        explicit I2C(const char * device);
+
+       /**
+        * @brief Constructor for I2C object bound to emulated devices
+        * @param emulator Reference to opened MappedEeprom
+       */
+        explicit I2C(MappedEeprom& emulator);
+
+        ~I2C();
+
+        I2C(const I2C&) = delete;
+        I2C& operator=(const I2C&) = delete;
+
+        /**
+         * @brief Open the bus device; safe to call repeatedly
+        */
+        void init();
+
+        /**
+         * @brief Check whether the bus device is open
+        */
+        bool isOpen() const { return (_fd >= 0) || _emulator; }
+
+        /**
+         * @brief Charge emulated transfers to the virtual clock at the given SCL rate
+         * @param hz Bus clock in Hz; zero for instantaneous transfers
+        */
+        void setBusHz(uint32_t hz) { _bus_hz = hz; }
+
+        /**
+         * @brief Get total emulated transfer time charged since construction
+        */
+        uint64_t busTimeUs() const { return _bus_time_us; }
+
+        int write(uint8_t addr, uint8_t reg, uint8_t * vals, uint16_t len);
+        int write(uint8_t addr, uint16_t reg, uint8_t * vals, uint16_t len);
+        int writeRead(uint8_t addr, uint8_t reg, uint8_t * vals, uint16_t len);
+        int writeRead(uint8_t addr, uint16_t reg, uint8_t * vals, uint16_t len);
+
+    private:
+        int  transfer(uint8_t addr, const uint8_t * reg, uint8_t reg_len, uint8_t * vals, uint16_t len, bool read);
+        void chargeBus(uint32_t bytes);
+
+        char          _device[64];
+        int           _fd;
+        MappedEeprom* _emulator;
+        uint32_t      _bus_hz;
+        uint64_t      _bus_time_us;
+        std::mutex    _lock;
+};
+
+}
+
+#endif // _HAL_H
+
+// EOF
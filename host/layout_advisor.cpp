@@ -0,0 +1,419 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : layout_advisor.cpp
+// Purpose     : AT24CXX Data Layout Advisor
+// Description : This source file implements header file layout_advisor.h.
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include "layout_advisor.h"
+
+namespace PeripheralIO
+{
+
+LayoutAdvisor::LayoutAdvisor(uint32_t window_us)
+: _window_us(window_us)
+{ }
+
+bool LayoutAdvisor::loadFields(const char * path, std::vector<LayoutField>& fields, std::string& error)
+{
+    FILE *   file = fopen(path, "r");
+    char     line[256];
+    unsigned number = 0;
+
+    fields.clear();
+
+    if (!file)
+    {
+        error = std::string("cannot open ") + path;
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), file))
+    {
+        char *      name = strtok(line, ",\r\n");
+        char *      addr = name ? strtok(nullptr, ",\r\n") : nullptr;
+        char *      size = addr ? strtok(nullptr, ",\r\n") : nullptr;
+        char *      end_addr;
+        char *      end_size;
+        LayoutField field;
+
+        number++;
+
+        if (!name || ('#' == name[0]))
+            continue;
+
+        field.name    = name;
+        field.address = addr ? (uint32_t)strtoul(addr, &end_addr, 0) : 0;
+        field.size    = size ? (uint32_t)strtoul(size, &end_size, 0) : 0;
+
+        if (!addr || !size || (end_addr == addr) || (end_size == size) || !field.size)
+        {
+            // Tolerate a header line
+            if (1 == number)
+                continue;
+
+            fclose(file);
+            error = std::string(path) + ":" + std::to_string(number) + ": expected name,address,size";
+            return false;
+        }
+
+        fields.push_back(field);
+    }
+
+    fclose(file);
+
+    for (size_t i = 0; i < fields.size(); i++)
+    {
+        for (size_t j = i + 1; j < fields.size(); j++)
+        {
+            if ((fields[i].address < fields[j].address + fields[j].size) &&
+                (fields[j].address < fields[i].address + fields[i].size))
+            {
+                error = "fields " + fields[i].name + " and " + fields[j].name + " overlap";
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void LayoutAdvisor::analyze(const std::vector<EepromTraceEvent>& events, const std::vector<LayoutField>& fields,
+                            uint16_t page_size)
+{
+    std::vector<size_t>          order(fields.size());
+    std::map<uint64_t, uint64_t> page_cycles;
+    uint32_t                     last  = 0;
+    bool                         first = true;
+
+    _fields = fields;
+    _bursts.clear();
+    _heat.assign(fields.size(), 0);
+    _straddles.assign(fields.size(), 0);
+    _affinity.assign(fields.size(), std::vector<uint64_t>(fields.size(), 0));
+    _hot_pages.clear();
+    _split_pairs.clear();
+    _straddlers.clear();
+
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return fields[a].address < fields[b].address; });
+
+    // Split each write into per-field segments and group writes into bursts
+    for (const EepromTraceEvent& event : events)
+    {
+        uint32_t pos = event.address;
+        uint32_t end = (uint32_t)event.address + event.len;
+
+        if ((EEPROM_TRACE_WRITE != event.op) || !event.len)
+            continue;
+
+        if (first || ((uint32_t)(event.timestamp_us - last) > _window_us))
+            _bursts.push_back(Burst());
+
+        first = false;
+        last  = event.timestamp_us;
+
+        for (size_t k = 0; (k < order.size()) && (pos < end); k++)
+        {
+            const LayoutField& f     = fields[order[k]];
+            uint32_t           f_end = f.address + f.size;
+
+            if (f_end <= pos)
+                continue;
+
+            if (f.address >= end)
+                break;
+
+            if (f.address > pos)
+            {
+                _bursts.back().push_back(Segment{ -1, pos, f.address - pos });
+                pos = f.address;
+            }
+
+            _bursts.back().push_back(Segment{ (long)order[k], pos - f.address, std::min(end, f_end) - pos });
+            pos = std::min(end, f_end);
+        }
+
+        if (pos < end)
+            _bursts.back().push_back(Segment{ -1, pos, end - pos });
+    }
+
+    for (const Burst& burst : _bursts)
+    {
+        std::map<size_t, std::set<uint32_t> > written;
+        std::set<uint64_t>                     pages;
+
+        for (const Segment& seg : burst)
+        {
+            uint32_t start = (seg.field < 0) ? seg.offset : fields[seg.field].address + seg.offset;
+
+            for (uint32_t p = start / page_size; p <= (start + seg.len - 1) / page_size; p++)
+            {
+                pages.insert(p);
+
+                if (seg.field >= 0)
+                    written[(size_t)seg.field].insert(p);
+            }
+        }
+
+        for (uint64_t p : pages)
+            page_cycles[p]++;
+
+        for (auto& w : written)
+        {
+            size_t a = w.first;
+
+            _heat[a]++;
+
+            if (w.second.size() > 1)
+                _straddles[a]++;
+
+            for (auto& v : written)
+            {
+                if (a != v.first)
+                    _affinity[a][v.first]++;
+            }
+        }
+    }
+
+    for (auto& pc : page_cycles)
+        _hot_pages.push_back(LayoutPage{ (uint32_t)pc.first, pc.second });
+
+    std::sort(_hot_pages.begin(), _hot_pages.end(),
+              [](const LayoutPage& a, const LayoutPage& b) { return a.cycles > b.cycles; });
+
+    for (size_t a = 0; a < fields.size(); a++)
+    {
+        uint32_t a_first = fields[a].address / page_size;
+        uint32_t a_last  = (fields[a].address + fields[a].size - 1) / page_size;
+
+        if (_straddles[a])
+            _straddlers.push_back(a);
+
+        for (size_t b = a + 1; b < fields.size(); b++)
+        {
+            uint32_t b_first = fields[b].address / page_size;
+            uint32_t b_last  = (fields[b].address + fields[b].size - 1) / page_size;
+
+            if (_affinity[a][b] && ((a_last < b_first) || (b_last < a_first)))
+                _split_pairs.push_back(LayoutPair{ a, b, _affinity[a][b] });
+        }
+    }
+
+    std::sort(_straddlers.begin(), _straddlers.end(), [&](size_t a, size_t b) { return _straddles[a] > _straddles[b]; });
+    std::sort(_split_pairs.begin(), _split_pairs.end(),
+              [](const LayoutPair& a, const LayoutPair& b) { return a.bursts > b.bursts; });
+}
+
+bool LayoutAdvisor::propose(uint16_t page_size, uint32_t chip_size, std::vector<LayoutField>& layout) const
+{
+    std::vector<bool>   placed(_fields.size(), false);
+    std::vector<bool>   taken;        // bytes in use from lo
+    std::vector<size_t> by_heat;
+    uint32_t            lo = UINT32_MAX;
+    uint32_t            hi = 0;
+
+    layout = _fields;
+
+    if (_fields.empty())
+        return true;
+
+    for (size_t i = 0; i < _fields.size(); i++)
+    {
+        by_heat.push_back(i);
+        lo = std::min(lo, _fields[i].address);
+        hi = std::max(hi, _fields[i].address + _fields[i].size);
+    }
+
+    // Placement stays within the span of the current layout, cut short by the target chip
+    hi = std::min(hi, chip_size);
+
+    if (lo >= hi)
+        return false;
+
+    taken.assign(hi - lo, false);
+
+    // Written bytes outside every field belong to someone else and stay where they are
+    for (const Burst& burst : _bursts)
+    {
+        for (const Segment& seg : burst)
+        {
+            if (seg.field >= 0)
+                continue;
+
+            for (uint32_t a = std::max(seg.offset, lo); a < std::min(seg.offset + seg.len, hi); a++)
+                taken[a - lo] = true;
+        }
+    }
+
+    std::stable_sort(by_heat.begin(), by_heat.end(), [&](size_t a, size_t b) { return _heat[a] > _heat[b]; });
+
+    // Lowest free address for len bytes, optionally page-aligned or kept from straddling; UINT32_MAX if none
+    auto fit = [&](uint32_t len, bool aligned, bool straddle)
+    {
+        uint32_t a = lo;
+
+        while ((uint64_t)a + len <= hi)
+        {
+            uint32_t k;
+
+            if (aligned && (a % page_size))
+            {
+                a += page_size - a % page_size;
+                continue;
+            }
+
+            if (!straddle && (len <= page_size) && (a % page_size + len > page_size))
+            {
+                a += page_size - a % page_size;
+                continue;
+            }
+
+            for (k = 0; (k < len) && !taken[a - lo + k]; k++)
+                ;
+
+            if (k == len)
+                return a;
+
+            a += k + 1;
+        }
+
+        return UINT32_MAX;
+    };
+
+    auto place = [&](size_t f, uint32_t address)
+    {
+        layout[f].address = address;
+        placed[f]         = true;
+
+        for (uint32_t a = address; a < address + _fields[f].size; a++)
+            taken[a - lo] = true;
+    };
+
+    // Written fields larger than a page start on a page of their own, spanning as few as possible
+    for (size_t f : by_heat)
+    {
+        uint32_t address;
+
+        if (!_heat[f] || (_fields[f].size <= page_size))
+            continue;
+
+        if (UINT32_MAX != (address = fit(_fields[f].size, true, true)))
+            place(f, address);
+    }
+
+    // Give the hottest field and its strongest co-written companions one page together
+    for (size_t seed : by_heat)
+    {
+        uint32_t            used;
+        uint32_t            address;
+        std::vector<size_t> group;
+
+        if (placed[seed] || !_heat[seed] || (_fields[seed].size > page_size))
+            continue;
+
+        group.push_back(seed);
+        placed[seed] = true;
+        used         = _fields[seed].size;
+
+        for (;;)
+        {
+            long     best       = -1;
+            uint64_t best_score = 0;
+
+            for (size_t c : by_heat)
+            {
+                uint64_t score = 0;
+
+                if (placed[c] || (used + _fields[c].size > page_size))
+                    continue;
+
+                for (size_t g : group)
+                    score += _affinity[c][g];
+
+                if (score > best_score)
+                {
+                    best       = (long)c;
+                    best_score = score;
+                }
+            }
+
+            if (best < 0)
+                break;
+
+            group.push_back((size_t)best);
+            placed[best] = true;
+            used        += _fields[best].size;
+        }
+
+        // Companionless fields and groups finding no room are packed one by one below
+        if ((1 == group.size()) || (UINT32_MAX == (address = fit(used, false, false))))
+        {
+            for (size_t g : group)
+                placed[g] = false;
+
+            continue;
+        }
+
+        for (size_t g : group)
+        {
+            place(g, address);
+            address += _fields[g].size;
+        }
+    }
+
+    // Remaining fields by heat, first-fit without straddling where possible
+    for (size_t f : by_heat)
+    {
+        uint32_t address;
+
+        if (placed[f])
+            continue;
+
+        if ((UINT32_MAX == (address = fit(_fields[f].size, false, false))) &&
+            (UINT32_MAX == (address = fit(_fields[f].size, false, true))))
+            return false;
+
+        place(f, address);
+    }
+
+    return true;
+}
+
+uint64_t LayoutAdvisor::cycles(const std::vector<LayoutField>& layout, uint16_t page_size) const
+{
+    uint64_t total = 0;
+
+    for (const Burst& burst : _bursts)
+    {
+        std::set<uint64_t> pages;
+
+        for (const Segment& seg : burst)
+        {
+            // Bytes outside every field stay where they are
+            uint32_t start = (seg.field < 0) ? seg.offset : layout[seg.field].address + seg.offset;
+
+            for (uint32_t p = start / page_size; p <= (start + seg.len - 1) / page_size; p++)
+                pages.insert(p);
+        }
+
+        total += pages.size();
+    }
+
+    return total;
+}
+
+}
+
+// EOF
@@ -0,0 +1,160 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : layout_advisor.h
+// Purpose     : AT24CXX Data Layout Advisor
+// Description :
+//               Analyzes a recorded access trace (at24cxx_trace.h) against a field map of the application's EEPROM
+//               layout, and proposes a repacked layout that needs fewer write cycles. Write calls are grouped into
+//               bursts, runs of writes separated by no more than a time window; the write cost of a burst is
+//               the number of distinct pages it touches, i.e. the cycles taken when each burst's writes are
+//               combined per page. A zero window costs each call separately, as the plain driver does.
+//
+//               The analysis reports hot pages by write cycles, fields whose writes straddle a page boundary and
+//               so cost an extra cycle, and pairs of fields written in the same bursts but living on different
+//               pages.
+//
+//               The proposal is greedy: starting from the most frequently written field, each page is filled with
+//               the unplaced fields having the greatest co-write affinity to those already on it. Fields larger
+//               than a page are page-aligned to span the fewest pages, and the remaining fields are packed
+//               first-fit into leftover space without straddling. The proposal is then costed against the same
+//               trace with the chosen page size, with written offsets within each field preserved.
+//
+//               Fields are only placed within the address span of the current layout, cut short at the end of the
+//               target chip, and never over bytes the trace wrote outside every field. A proposal that does not
+//               fit is reported as a failure.
+//
+//               Field map: CSV lines of name,address,size; '#' comments and a header line are ignored.
+//
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : at24cxx_trace.h
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _LAYOUT_ADVISOR_H
+#define _LAYOUT_ADVISOR_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "at24cxx_trace.h"
+
+namespace PeripheralIO
+{
+
+struct LayoutField
+{
+    std::string name;
+    uint32_t    address;
+    uint32_t    size;
+};
+
+struct LayoutPage
+{
+    uint32_t page;
+    uint64_t cycles;
+};
+
+struct LayoutPair
+{
+    size_t   a;              // field indices
+    size_t   b;
+    uint64_t bursts;         // bursts writing both
+};
+
+class LayoutAdvisor
+{
+    public:
+       /**
+        * @brief Constructor for LayoutAdvisor object
+        * @param window_us Largest gap between writes of one burst; 0 treats every write call separately
+       */
+        explicit LayoutAdvisor(uint32_t window_us);
+
+        /**
+         * @brief Parse field map
+         * @param path Path of CSV file
+         * @param fields Out: fields in file order
+         * @param error Out: description of failure
+         * @return False for unreadable file, malformed line or overlapping fields, true otherwise
+        */
+        static bool loadFields(const char * path, std::vector<LayoutField>& fields, std::string& error);
+
+        /**
+         * @brief Analyze write events of a trace against the field map in use when it was recorded
+         * @param events Trace events; reads are ignored
+         * @param fields Field map
+         * @param page_size Page size of the traced chip
+        */
+        void analyze(const std::vector<EepromTraceEvent>& events, const std::vector<LayoutField>& fields,
+                     uint16_t page_size);
+
+        /**
+         * @brief Get pages by descending write cycles
+        */
+        const std::vector<LayoutPage>& hotPages() const { return _hot_pages; }
+
+        /**
+         * @brief Get co-written field pairs sharing no page, by descending burst count
+        */
+        const std::vector<LayoutPair>& splitPairs() const { return _split_pairs; }
+
+        /**
+         * @brief Get indices of fields whose writes crossed a page boundary, by descending straddled bursts
+        */
+        const std::vector<size_t>& straddlers() const { return _straddlers; }
+
+        /**
+         * @brief Get number of bursts writing a field
+        */
+        uint64_t heat(size_t field) const { return _heat.at(field); }
+
+        /**
+         * @brief Get number of bursts in which a field's written bytes spanned more than one page
+        */
+        uint64_t straddles(size_t field) const { return _straddles.at(field); }
+
+        /**
+         * @brief Propose repacked layout within the span of the current layout
+         * @param page_size Page size of the target chip
+         * @param chip_size Size of the target chip in bytes
+         * @param layout Out: fields in original order with new addresses
+         * @return False if the fields do not fit the span, cut to the chip size, around unmapped written bytes
+        */
+        bool propose(uint16_t page_size, uint32_t chip_size, std::vector<LayoutField>& layout) const;
+
+        /**
+         * @brief Cost analyzed bursts under a layout
+         * @param layout Fields in original order, at current or proposed addresses
+         * @param page_size Page size of the chip
+         * @return Write cycles
+        */
+        uint64_t cycles(const std::vector<LayoutField>& layout, uint16_t page_size) const;
+
+    private:
+        // Written byte range, relative to a field or absolute when outside every field
+        struct Segment
+        {
+            long     field;
+            uint32_t offset;
+            uint32_t len;
+        };
+
+        typedef std::vector<Segment> Burst;
+
+        uint32_t                          _window_us;
+        std::vector<LayoutField>          _fields;
+        std::vector<Burst>                _bursts;
+        std::vector<uint64_t>             _heat;
+        std::vector<uint64_t>             _straddles;
+        std::vector<std::vector<uint64_t>> _affinity;
+        std::vector<LayoutPage>           _hot_pages;
+        std::vector<LayoutPair>           _split_pairs;
+        std::vector<size_t>               _straddlers;
+};
+
+}
+
+#endif // _LAYOUT_ADVISOR_H
+
+// EOF
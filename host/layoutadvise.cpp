@@ -0,0 +1,164 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : layoutadvise.cpp
+// Purpose     : AT24CXX Data Layout Advisor Command Line Tool
+// Description :
+//               Reports hot pages, straddling fields and co-written fields split across pages for a recorded
+//               trace and field map, then prints a proposed layout as a field map with its predicted write cycles.
+//
+//               Usage: layoutadvise [-w window_us] [-c chip] [-n top] [-o proposed.csv] <trace> <fields.csv>
+//                      -w window_us     largest gap between writes of one burst (default 0, each call alone)
+//                      -c chip          target chip for the proposal (default the traced chip)
+//                      -n top           entries listed per report (default 10)
+//                      -o proposed.csv  write proposed field map to file rather than standard output
+//
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "chip_names.h"
+#include "layout_advisor.h"
+#include "trace_replay.h"
+
+using namespace PeripheralIO;
+
+static uint16_t pageSizeOf(uint32_t chip)
+{
+    return (uint16_t)((chip & 0x0FF00000) >> 20);
+}
+
+static uint32_t chipSizeOf(uint32_t chip)
+{
+    return chip & 0x0001FFFF;
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t                 window = 0;
+    uint32_t                 target = 0;
+    size_t                   top    = 10;
+    const char *             output = nullptr;
+    FILE *                   out    = stdout;
+    TraceReplay              trace;
+    std::vector<LayoutField> fields;
+    std::vector<LayoutField> proposal;
+    std::string              error;
+    uint64_t                 before;
+    uint64_t                 after;
+    int                      opt;
+
+    while ((opt = getopt(argc, argv, "w:c:n:o:")) != -1)
+    {
+        if ('w' == opt)
+        {
+            window = (uint32_t)strtoul(optarg, nullptr, 0);
+        }
+        else if ('c' == opt)
+        {
+            if (!chipByName(optarg, target))
+            {
+                fprintf(stderr, "unknown chip %s\n", optarg);
+                return 2;
+            }
+        }
+        else if ('n' == opt)
+        {
+            top = (size_t)strtoul(optarg, nullptr, 0);
+        }
+        else if ('o' == opt)
+        {
+            output = optarg;
+        }
+        else
+        {
+            return 2;
+        }
+    }
+
+    if (optind + 2 != argc)
+    {
+        fprintf(stderr, "usage: %s [-w window_us] [-c chip] [-n top] [-o proposed.csv] <trace> <fields.csv>\n",
+                argv[0]);
+        return 2;
+    }
+
+    if (!trace.load(argv[optind], error) || !LayoutAdvisor::loadFields(argv[optind + 1], fields, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    if (!target)
+        target = trace.chip();
+
+    LayoutAdvisor advisor(window);
+    uint16_t      page_size = pageSizeOf(trace.chip());
+
+    advisor.analyze(trace.events(), fields, page_size);
+
+    printf("hot pages (%u-byte):\n", page_size);
+
+    for (size_t i = 0; (i < advisor.hotPages().size()) && (i < top); i++)
+    {
+        const LayoutPage& p = advisor.hotPages()[i];
+        printf("  page %-5u 0x%04x  %llu cycles\n", p.page, p.page * page_size, (unsigned long long)p.cycles);
+    }
+
+    printf("straddling fields:\n");
+
+    for (size_t i = 0; (i < advisor.straddlers().size()) && (i < top); i++)
+    {
+        const LayoutField& f = fields[advisor.straddlers()[i]];
+        printf("  %-20s 0x%04x+%u  straddled in %llu of %llu bursts\n", f.name.c_str(), f.address, f.size,
+               (unsigned long long)advisor.straddles(advisor.straddlers()[i]),
+               (unsigned long long)advisor.heat(advisor.straddlers()[i]));
+    }
+
+    printf("co-written fields on different pages:\n");
+
+    for (size_t i = 0; (i < advisor.splitPairs().size()) && (i < top); i++)
+    {
+        const LayoutPair& p = advisor.splitPairs()[i];
+        printf("  %-20s %-20s %llu bursts\n", fields[p.a].name.c_str(), fields[p.b].name.c_str(),
+               (unsigned long long)p.bursts);
+    }
+
+    if (!advisor.propose(pageSizeOf(target), chipSizeOf(target), proposal))
+    {
+        fprintf(stderr, "fields do not fit the span of the current layout on the target chip\n");
+        return 1;
+    }
+
+    before   = advisor.cycles(fields, page_size);
+    after    = advisor.cycles(proposal, pageSizeOf(target));
+
+    printf("write cycles: current %llu, proposed %llu (%.1f%% reduction)\n", (unsigned long long)before,
+           (unsigned long long)after, before ? 100.0 * ((double)before - (double)after) / (double)before : 0.0);
+
+    if (output && !(out = fopen(output, "w")))
+    {
+        fprintf(stderr, "cannot write %s\n", output);
+        return 1;
+    }
+
+    if (!output)
+        printf("proposed layout:\n");
+
+    fprintf(out, "name,address,size\n");
+
+    for (const LayoutField& f : proposal)
+        fprintf(out, "%s,0x%04x,%u\n", f.name.c_str(), f.address, f.size);
+
+    if (output)
+        fclose(out);
+
+    return 0;
+}
+
+// EOF
@@ -0,0 +1,236 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : mapped_eeprom.cpp
+// Purpose     : Memory-Mapped File-Backed AT24CXX Emulation
+// Description : This source file implements header file mapped_eeprom.h.
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "hal.h"
+#include "mapped_eeprom.h"
+
+namespace HAL
+{
+
+// Emulation Defines
+const uint8_t EEPROM_BUS_ADDR = 0x50; // 7-bit base address of AT24CXX family
+
+
+MappedEeprom::MappedEeprom(const char * path)
+: _path(path)
+, _image(nullptr)
+, _size(0)
+, _fd(-1)
+, _write_cycle_us(0)
+, _policy(SyncPolicy::None)
+, _writes(0)
+, _reads(0)
+, _bytes_written(0)
+, _bytes_read(0)
+, _nacks(0)
+{ }
+
+MappedEeprom::~MappedEeprom()
+{
+    if (_image)
+    {
+        msync(_image, _size, MS_SYNC);
+        munmap(_image, _size);
+    }
+
+    if (_fd >= 0)
+        close(_fd);
+}
+
+bool MappedEeprom::addDevice(uint32_t chip, uint8_t chip_addr)
+{
+    Device dev;
+
+    if (_image)
+        return false;
+
+    // Decode chip selection constant (chip size | page size | addr bytes | addr overflow bits)
+    dev.size       = chip & 0x0001FFFF;
+    dev.page_size  = (uint16_t)((chip & 0x0FF00000) >> 20);
+    dev.addr_bytes = (uint8_t)((chip & 0x30000000) >> 28);
+    dev.ov_mask    = (uint8_t)((1 << ((chip & 0xC0000000) >> 30)) - 1);
+    dev.bus_addr   = (uint8_t)((EEPROM_BUS_ADDR | (chip_addr & 0x07)) & ~dev.ov_mask);
+    dev.offset     = _size;
+    dev.busy_since = 0;
+    dev.busy       = false;
+
+    for (const Device& other : _devices)
+    {
+        if ((other.bus_addr & ~(other.ov_mask | dev.ov_mask)) == (dev.bus_addr & ~(other.ov_mask | dev.ov_mask)))
+            return false;
+    }
+
+    _devices.push_back(dev);
+    _size += dev.size;
+
+    return true;
+}
+
+bool MappedEeprom::open(std::string& error)
+{
+    struct stat st;
+    void*       map;
+
+    if (_image || (0 == _size))
+    {
+        error = _image ? "already open" : "no devices";
+        return false;
+    }
+
+    _fd = ::open(_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+    if ((_fd < 0) || (fstat(_fd, &st) < 0))
+    {
+        error = "cannot open " + _path + ": " + strerror(errno);
+        return false;
+    }
+
+    if (((size_t)st.st_size < _size) && (ftruncate(_fd, (off_t)_size) < 0))
+    {
+        error = "cannot size " + _path + ": " + strerror(errno);
+        return false;
+    }
+
+    map = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+
+    if (MAP_FAILED == map)
+    {
+        error = "cannot map " + _path + ": " + strerror(errno);
+        return false;
+    }
+
+    _image = (uint8_t*)map;
+
+    // Bytes beyond the previous end of file start in the erased state
+    if ((size_t)st.st_size < _size)
+        memset(_image + st.st_size, 0xFF, _size - (size_t)st.st_size);
+
+    return true;
+}
+
+bool MappedEeprom::sync()
+{
+    return _image && (0 == msync(_image, _size, MS_SYNC));
+}
+
+MappedEeprom::Stats MappedEeprom::stats() const
+{
+    return Stats{ _writes.load(), _reads.load(), _bytes_written.load(), _bytes_read.load(), _nacks.load() };
+}
+
+bool MappedEeprom::ready(uint8_t addr)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    Device*                     dev = match(addr);
+
+    return _image && dev && (!dev->busy || ((uint32_t)(micros() - dev->busy_since) >= _write_cycle_us));
+}
+
+int MappedEeprom::transfer(uint8_t addr, const uint8_t * reg, uint8_t reg_len, uint8_t * vals, uint16_t len,
+                           bool read)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    Device*                     dev = match(addr);
+    uint32_t                    word;
+    uint32_t                    page_base;
+    uint8_t*                    array;
+
+    if (!_image || !dev || (reg_len != dev->addr_bytes))
+    {
+        _nacks++;
+        return -1;
+    }
+
+    if (dev->busy)
+    {
+        if ((uint32_t)(micros() - dev->busy_since) < _write_cycle_us)
+        {
+            _nacks++;
+            return -1;
+        }
+
+        dev->busy = false;
+    }
+
+    // Word address; upper bits of one-byte parts come from the bus address, excess bits are ignored
+    if (2 == reg_len)
+        word = (uint32_t)((reg[0] << 8) | reg[1]);
+    else
+        word = (uint32_t)(reg[0] | ((addr & dev->ov_mask) << 8));
+
+    word  &= dev->size - 1;
+    array  = _image + dev->offset;
+
+    if (read)
+    {
+        for (uint16_t i = 0; i < len; i++)
+            vals[i] = array[(word + i) & (dev->size - 1)];
+
+        _reads++;
+        _bytes_read += len;
+        return 0;
+    }
+
+    // Address pointer set only; no write cycle
+    if (0 == len)
+        return 0;
+
+    page_base = word & ~(uint32_t)(dev->page_size - 1);
+
+    for (uint16_t i = 0; i < len; i++)
+        array[page_base + ((word - page_base + i) & (dev->page_size - 1))] = vals[i];
+
+    _writes++;
+    _bytes_written += len;
+
+    if (_write_cycle_us)
+    {
+        dev->busy       = true;
+        dev->busy_since = micros();
+    }
+
+    flushRange(dev->offset + page_base, dev->page_size);
+    return 0;
+}
+
+// Private: Locate device answering at bus address
+MappedEeprom::Device* MappedEeprom::match(uint8_t addr)
+{
+    for (Device& dev : _devices)
+    {
+        if ((addr & ~dev.ov_mask) == dev.bus_addr)
+            return &dev;
+    }
+
+    return nullptr;
+}
+
+// Private: Apply sync policy to memory pages spanning an image range
+void MappedEeprom::flushRange(size_t offset, size_t len)
+{
+    static const size_t sys_page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t              start;
+
+    if (SyncPolicy::None == _policy)
+        return;
+
+    start = offset & ~(sys_page - 1);
+    msync(_image + start, offset + len - start, (SyncPolicy::Sync == _policy) ? MS_SYNC : MS_ASYNC);
+}
+
+}
+
+// EOF
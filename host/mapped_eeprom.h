@@ -0,0 +1,158 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : mapped_eeprom.h
+// Purpose     : Memory-Mapped File-Backed AT24CXX Emulation
+// Description :
+//               Emulates one or more AT24CXX devices on a shared memory mapping of an image file, for Linux ports
+//               of firmware without a real EEPROM and for fast tests. A HAL::I2C constructed over a MappedEeprom
+//               routes its transfers here instead of to i2c-dev; writes land directly in the mapped image with no
+//               intermediate buffer, and reads are served from it.
+//
+//               Device semantics follow the datasheet byte for byte: writes wrap within the addressed page,
+//               sequential reads wrap at the end of the array, address bits beyond the array are ignored, and
+//               AT24C04/08/16 parts answer on consecutive bus addresses carrying the upper address bits. An optional
+//               write cycle time makes a device NACK every transfer until its write cycle has elapsed.
+//
+//               Durability is controlled by a sync policy: None leaves write-back to the kernel, Async schedules
+//               write-back of the touched memory pages after each EEPROM write, and Sync waits for it.
+//
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Hosted Linux HAL (host/hal.h)
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _MAPPED_EEPROM_H
+#define _MAPPED_EEPROM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace HAL
+{
+
+class MappedEeprom
+{
+    public:
+        enum class SyncPolicy { None, Async, Sync };
+
+        struct Stats
+        {
+            uint64_t writes;
+            uint64_t reads;
+            uint64_t bytes_written;
+            uint64_t bytes_read;
+            uint64_t nacks;
+        };
+
+       /**
+        * @brief Constructor for MappedEeprom object
+        * @param path Path of image file; created and filled with 0xFF if absent or too short
+       */
+        explicit MappedEeprom(const char * path);
+
+        ~MappedEeprom();
+
+        MappedEeprom(const MappedEeprom&) = delete;
+        MappedEeprom& operator=(const MappedEeprom&) = delete;
+
+        /**
+         * @brief Add emulated device; must be called prior to open()
+         * @param chip Defined const value for chip (e.g. PeripheralIO::AT24C256)
+         * @param chip_addr Externally biased address of chip
+         * @return False if already open or bus address conflicts with another device, true otherwise
+        */
+        bool addDevice(uint32_t chip, uint8_t chip_addr=0);
+
+        /**
+         * @brief Create or extend the image file and map it; devices are laid out in order of addition
+         * @param error Out: description of failure
+         * @return False on file or mapping error, true otherwise
+        */
+        bool open(std::string& error);
+
+        /**
+         * @brief Set simulated write cycle time; zero completes writes instantly
+        */
+        void setWriteCycleUs(uint32_t us) { _write_cycle_us = us; }
+
+        /**
+         * @brief Set durability policy applied after each EEPROM write
+        */
+        void setSyncPolicy(SyncPolicy policy) { _policy = policy; }
+
+        /**
+         * @brief Flush the entire image to the file and wait for completion
+         * @return False on error, true otherwise
+        */
+        bool sync();
+
+        /**
+         * @brief Get pointer to mapped image and its size in bytes
+        */
+        uint8_t * image() const { return _image; }
+        size_t    size() const { return _size; }
+
+        /**
+         * @brief Get byte offset of a device's array within the image
+         * @param index Device index in order of addition
+        */
+        size_t deviceOffset(size_t index) const { return _devices.at(index).offset; }
+
+        /**
+         * @brief Get snapshot of transfer counters
+        */
+        Stats stats() const;
+
+        /**
+         * @brief Check whether a device would acknowledge its address now, without counting a transfer
+         * @param addr 7-bit bus address
+        */
+        bool ready(uint8_t addr);
+
+        /**
+         * @brief Emulate I2C transfer; called by HAL::I2C
+         * @return Zero for ACK, nonzero for NACK or unknown address
+        */
+        int transfer(uint8_t addr, const uint8_t * reg, uint8_t reg_len, uint8_t * vals, uint16_t len, bool read);
+
+    private:
+        struct Device
+        {
+            uint32_t size;
+            uint16_t page_size;
+            uint8_t  addr_bytes;
+            uint8_t  ov_mask;
+            uint8_t  bus_addr;
+            size_t   offset;
+            uint32_t busy_since;
+            bool     busy;
+        };
+
+        Device* match(uint8_t addr);
+        void    flushRange(size_t offset, size_t len);
+
+        std::vector<Device>   _devices;
+        std::string           _path;
+        std::mutex            _lock;
+        uint8_t *             _image;
+        size_t                _size;
+        int                   _fd;
+        uint32_t              _write_cycle_us;
+        SyncPolicy            _policy;
+        std::atomic<uint64_t> _writes;
+        std::atomic<uint64_t> _reads;
+        std::atomic<uint64_t> _bytes_written;
+        std::atomic<uint64_t> _bytes_read;
+        std::atomic<uint64_t> _nacks;
+};
+
+}
+
+#endif // _MAPPED_EEPROM_H
+
+// EOF
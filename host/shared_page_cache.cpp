@@ -0,0 +1,359 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : shared_page_cache.cpp
+// Purpose     : Cross-Process Shared-Memory AT24CXX Page Cache
+// Description : This source file implements header file shared_page_cache.h.
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <thread>
+#include "shared_page_cache.h"
+
+namespace PeripheralIO
+{
+
+// Shared Segment Defines
+const uint32_t SHARED_CACHE_MAGIC    = 0x41543244; // "AT2D"
+const int      SHARED_CACHE_ATTEMPTS = 4;          // optimistic copies before falling back to the bus
+const int      SHARED_CACHE_BUS_MS   = 10;         // retry window for bus reads NACKed by another's write cycle
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared seqlocks require address-free atomics");
+
+
+SharedPageCache::SharedPageCache(AT24CXX& eeprom, const char * name)
+: _eeprom(eeprom)
+, _name(name)
+, _base(nullptr)
+, _size(0)
+, _slot_size(0)
+, _page_size(eeprom.pageSize())
+, _hits(0)
+, _misses(0)
+, _bypasses(0)
+{ }
+
+SharedPageCache::~SharedPageCache()
+{
+    if (_base)
+        munmap(_base, _size);
+}
+
+bool SharedPageCache::open(std::string& error)
+{
+    uint32_t pages   = _eeprom.size() / _page_size;
+    bool     creator = true;
+    Header*  hdr;
+    void*    map;
+    int      fd;
+
+    // Slot header followed by page data, padded to keep every slot's atomics aligned
+    _slot_size = (sizeof(Slot) + _page_size + 7) & ~(size_t)7;
+    _size      = sizeof(Header) + 8 + pages * _slot_size;
+
+    fd = shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0660);
+
+    if ((fd < 0) && (EEXIST == errno))
+    {
+        creator = false;
+        fd      = shm_open(_name.c_str(), O_RDWR, 0660);
+    }
+
+    if (fd < 0)
+    {
+        error = "cannot open shared memory " + _name + ": " + strerror(errno);
+        return false;
+    }
+
+    if (creator && (ftruncate(fd, (off_t)_size) < 0))
+    {
+        error = "cannot size shared memory " + _name + ": " + strerror(errno);
+        close(fd);
+        ::shm_unlink(_name.c_str());
+        return false;
+    }
+
+    // An attaching process may observe the segment before its creator has sized it
+    for (int i = 0; !creator && (i < 1000); i++)
+    {
+        struct stat st;
+
+        if ((fstat(fd, &st) == 0) && ((size_t)st.st_size >= _size))
+            break;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    map = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (MAP_FAILED == map)
+    {
+        error = "cannot map shared memory " + _name + ": " + strerror(errno);
+        return false;
+    }
+
+    _base = (uint8_t*)map;
+    hdr   = (Header*)_base;
+
+    if (creator)
+    {
+        // Fresh segment is zero-filled: every slot starts at an even sequence and invalid
+        hdr->magic     = SHARED_CACHE_MAGIC;
+        hdr->chip_size = _eeprom.size();
+        hdr->page_size = _page_size;
+        hdr->pages     = pages;
+        hdr->ready.store(1, std::memory_order_release);
+        return true;
+    }
+
+    for (int i = 0; (i < 1000) && !hdr->ready.load(std::memory_order_acquire); i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    if (!hdr->ready.load(std::memory_order_acquire))
+    {
+        error = "shared memory " + _name + " was never initialized; its creator may have died, unlink it";
+        munmap(_base, _size);
+        _base = nullptr;
+        return false;
+    }
+
+    if ((SHARED_CACHE_MAGIC != hdr->magic)
+        || (hdr->chip_size != _eeprom.size()) || (hdr->page_size != _page_size) || (hdr->pages != pages))
+    {
+        error = "shared memory " + _name + " holds a different device geometry";
+        munmap(_base, _size);
+        _base = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+bool SharedPageCache::read(uint16_t address, uint8_t * vals, uint16_t len)
+{
+    uint16_t done = 0;
+    uint16_t offset;
+    uint16_t chunk;
+
+    if (!_base || ((uint32_t)(address + len) > _eeprom.size()))
+        return false;
+
+    while (done < len)
+    {
+        offset = (uint16_t)((address + done) % _page_size);
+        chunk  = ((_page_size - offset) < (len - done)) ? (_page_size - offset) : (len - done);
+
+        if (!readPage((uint16_t)((address + done) / _page_size), offset, &vals[done], chunk))
+            return false;
+
+        done += chunk;
+    }
+
+    return true;
+}
+
+bool SharedPageCache::write(uint16_t address, const uint8_t * vals, uint16_t len)
+{
+    uint16_t done = 0;
+    uint16_t page;
+    uint16_t offset;
+    uint16_t chunk;
+    uint32_t seq;
+    bool     ok;
+
+    if (!_base || ((uint32_t)(address + len) > _eeprom.size()))
+        return false;
+
+    while (done < len)
+    {
+        page   = (uint16_t)((address + done) / _page_size);
+        offset = (uint16_t)((address + done) % _page_size);
+        chunk  = ((_page_size - offset) < (len - done)) ? (_page_size - offset) : (len - done);
+
+        ok = _eeprom.write((uint16_t)(address + done), (uint8_t*)&vals[done], chunk);
+
+        // Page stays readable through the bus write and its write cycle; a fill that read the bus before the
+        // write landed holds its claim until published, so the patch below is applied after it
+        seq = claim(page);
+
+        if (ok && slot(page)->valid.load(std::memory_order_relaxed))
+            memcpy(data(page) + offset, &vals[done], chunk);
+        else
+            slot(page)->valid.store(0, std::memory_order_relaxed);
+
+        release(slot(page), seq);
+
+        if (!ok)
+            return false;
+
+        done += chunk;
+    }
+
+    return true;
+}
+
+void SharedPageCache::invalidate(uint16_t address, uint16_t len)
+{
+    uint32_t seq;
+
+    if (!_base || !len)
+        return;
+
+    for (uint32_t page = address / _page_size; page <= (uint32_t)(address + len - 1) / _page_size; page++)
+    {
+        seq = claim((uint16_t)page);
+        slot((uint16_t)page)->valid.store(0, std::memory_order_relaxed);
+        release(slot((uint16_t)page), seq);
+    }
+}
+
+bool SharedPageCache::unlink(const char * name)
+{
+    return (0 == ::shm_unlink(name));
+}
+
+SharedPageCache::Slot* SharedPageCache::slot(uint16_t page) const
+{
+    return (Slot*)(_base + sizeof(Header) + 8 + page * _slot_size);
+}
+
+uint8_t* SharedPageCache::data(uint16_t page) const
+{
+    return (uint8_t*)slot(page) + sizeof(Slot);
+}
+
+// Private: Serve part of one page from the cache, filling it on a miss
+bool SharedPageCache::readPage(uint16_t page, uint16_t offset, uint8_t * vals, uint16_t len)
+{
+    Slot*    s = slot(page);
+    uint32_t seq;
+
+    for (int attempt = 0; attempt < SHARED_CACHE_ATTEMPTS; attempt++)
+    {
+        seq = s->seq.load(std::memory_order_acquire);
+
+        if (seq & 1)
+        {
+            // A claim left by a process that died is taken over and the page dropped
+            if (!stale(s))
+                break;
+
+            seq = claim(page);
+            s->valid.store(0, std::memory_order_relaxed);
+            release(s, seq);
+            continue;
+        }
+
+        if (!s->valid.load(std::memory_order_relaxed))
+        {
+            // Miss: the reader that claims the page fills it for every process
+            if (!s->seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire))
+                continue;
+
+            own(s);
+
+            _misses++;
+
+            if (!busRead((uint16_t)(page * _page_size), data(page), _page_size))
+            {
+                release(s, seq);
+                return false;
+            }
+
+            memcpy(vals, data(page) + offset, len);
+            s->valid.store(1, std::memory_order_relaxed);
+            release(s, seq);
+            return true;
+        }
+
+        memcpy(vals, data(page) + offset, len);
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (s->seq.load(std::memory_order_relaxed) == seq)
+        {
+            _hits++;
+            return true;
+        }
+    }
+
+    // Page is being filled or written elsewhere; read around it rather than wait
+    _bypasses++;
+    return busRead((uint16_t)(page * _page_size + offset), vals, len);
+}
+
+// Private: Read from the bus, retrying while the device is NACKing through another process's write cycle
+bool SharedPageCache::busRead(uint16_t address, uint8_t * vals, uint16_t len)
+{
+    for (int ms = 0; ms < SHARED_CACHE_BUS_MS; ms++)
+    {
+        if (_eeprom.read(address, vals, len))
+            return true;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return _eeprom.read(address, vals, len);
+}
+
+// Private: Take exclusive ownership of a page slot, returning its even sequence before the claim
+uint32_t SharedPageCache::claim(uint16_t page)
+{
+    Slot*    s = slot(page);
+    uint32_t seq;
+
+    for (;;)
+    {
+        seq = s->seq.load(std::memory_order_relaxed);
+
+        if (!(seq & 1) && s->seq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire))
+        {
+            own(s);
+            return seq;
+        }
+
+        // Recover a claim whose owner died; advancing the odd sequence by two lets only one process take over
+        if ((seq & 1) && stale(s) && s->seq.compare_exchange_strong(seq, seq + 2, std::memory_order_acquire))
+        {
+            own(s);
+            s->valid.store(0, std::memory_order_relaxed);
+            return seq + 1;
+        }
+
+        std::this_thread::yield();
+    }
+}
+
+// Private: Record this process as owner of a claimed slot, ordering the claim before any data store
+void SharedPageCache::own(Slot* s)
+{
+    s->owner.store((int32_t)getpid(), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+// Private: Publish a claimed slot, returning its sequence to even
+void SharedPageCache::release(Slot* s, uint32_t seq)
+{
+    s->owner.store(0, std::memory_order_relaxed);
+    s->seq.store(seq + 2, std::memory_order_release);
+}
+
+// Private: Check whether a slot's claim is held by a process that no longer exists
+bool SharedPageCache::stale(const Slot* s) const
+{
+    int32_t owner = s->owner.load(std::memory_order_relaxed);
+
+    return (owner > 0) && (kill((pid_t)owner, 0) < 0) && (ESRCH == errno);
+}
+}
+
+// EOF
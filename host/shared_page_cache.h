@@ -0,0 +1,148 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : shared_page_cache.h
+// Purpose     : Cross-Process Shared-Memory AT24CXX Page Cache
+// Description :
+//               Page cache for AT24CXX contents placed in POSIX shared memory, so that every process on a host
+//               reading the same device shares one copy and each page is fetched from the bus once across all of
+//               them. Each cached page is guarded by a sequence lock: readers copy a page optimistically and retry
+//               only if its sequence changed meanwhile, and never block. A reader that misses claims the page by
+//               advancing its sequence to odd, fills it from the bus and publishes it; readers arriving while a
+//               page is claimed read their bytes from the bus directly rather than wait.
+//
+//               Writes are expected from a single writer process. A cached page stays readable while it is
+//               written on the bus and through the write cycle, during which the device NACKs; afterwards the
+//               writer claims the page and patches the cached copy (write-through), or invalidates it if the
+//               write failed. A fill racing with the write either read the bus before the write and is patched
+//               after it, or read it after. Bus reads by processes that miss during another's write cycle are
+//               retried for up to 10 ms.
+//
+//               Each claim records the claiming process's pid. A claim left behind by a process that died is
+//               taken over by the next process to find it, and the page is dropped. The pid is recorded just after
+//               the sequence turns odd; a process killed within that window leaves the page claimed without an
+//               owner, so the writer then blocks on that page until the segment is unlinked and recreated.
+//
+//               The segment is created by the first process to open it and carries the device geometry, which
+//               every later process must match.
+//
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Hosted Linux HAL (host/hal.h)
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _SHARED_PAGE_CACHE_H
+#define _SHARED_PAGE_CACHE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include "at24cxx.h"
+
+namespace PeripheralIO
+{
+
+class SharedPageCache
+{
+    public:
+        struct Stats
+        {
+            uint64_t hits;
+            uint64_t misses;
+            uint64_t bypasses;
+        };
+
+       /**
+        * @brief Constructor for SharedPageCache object
+        * @param eeprom Reference to initialized AT24CXX object used for fills and writes
+        * @param name Shared memory object name, e.g. "/at24cxx-i2c1-50"
+       */
+        SharedPageCache(AT24CXX& eeprom, const char * name);
+
+        ~SharedPageCache();
+
+        SharedPageCache(const SharedPageCache&) = delete;
+        SharedPageCache& operator=(const SharedPageCache&) = delete;
+
+        /**
+         * @brief Create or attach to the shared segment
+         * @param error Out: description of failure
+         * @return False on shared memory error or geometry mismatch, true otherwise
+        */
+        bool open(std::string& error);
+
+        /**
+         * @brief Read through the shared cache
+         * @param address Address from which values should be read
+         * @param vals Pointer to array into which read values will be placed
+         * @param len Number of bytes to read
+         * @return False for I2C error or invalid request, true otherwise
+        */
+        bool read(uint16_t address, uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Write to the device and update the shared cache; single writer process only
+         * @param address Starting address to which values should be written
+         * @param vals Pointer to array of values to write
+         * @param len Number of bytes to write
+         * @return False for I2C error or invalid request, true otherwise
+        */
+        bool write(uint16_t address, const uint8_t * vals, uint16_t len);
+
+        /**
+         * @brief Drop cached pages overlapping a range, e.g. after the device was written by other means
+        */
+        void invalidate(uint16_t address, uint16_t len);
+
+        /**
+         * @brief Get this process's cache counters
+        */
+        Stats stats() const { return Stats{ _hits, _misses, _bypasses }; }
+
+        /**
+         * @brief Remove the named shared segment; attached processes keep their mapping
+        */
+        static bool unlink(const char * name);
+
+    private:
+        struct Header
+        {
+            uint32_t              magic;
+            uint32_t              chip_size;
+            uint32_t              page_size;
+            uint32_t              pages;
+            std::atomic<uint32_t> ready;
+        };
+
+        struct Slot
+        {
+            std::atomic<uint32_t> seq;
+            std::atomic<uint32_t> valid;
+            std::atomic<int32_t>  owner; // pid holding the claim, 0 when free or not yet recorded
+        };
+
+        Slot*    slot(uint16_t page) const;
+        uint8_t* data(uint16_t page) const;
+        bool     readPage(uint16_t page, uint16_t offset, uint8_t * vals, uint16_t len);
+        bool     busRead(uint16_t address, uint8_t * vals, uint16_t len);
+        uint32_t claim(uint16_t page);
+        void     own(Slot* s);
+        void     release(Slot* s, uint32_t seq);
+        bool     stale(const Slot* s) const;
+
+        AT24CXX&    _eeprom;
+        std::string _name;
+        uint8_t*    _base;
+        size_t      _size;
+        size_t      _slot_size;
+        uint16_t    _page_size;
+        uint64_t    _hits;
+        uint64_t    _misses;
+        uint64_t    _bypasses;
+};
+
+}
+
+#endif // _SHARED_PAGE_CACHE_H
+
+// EOF
@@ -0,0 +1,427 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : trace_replay.cpp
+// Purpose     : AT24CXX Trace Replay Harness
+// Description : This source file implements header file trace_replay.h.
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include "at24cxx.h"
+#include "mapped_eeprom.h"
+#include "trace_replay.h"
+
+namespace PeripheralIO
+{
+
+// Page held by the coalescing model
+struct PendingPage
+{
+    uint64_t          since;
+    std::vector<bool> dirty;
+};
+
+// Private: Nearest-rank percentile of sorted samples
+static uint32_t percentile(const std::vector<uint32_t>& sorted, uint32_t pct)
+{
+    size_t rank;
+
+    if (sorted.empty())
+        return 0;
+
+    rank = (sorted.size() * pct + 99) / 100;
+
+    return sorted[(rank ? rank : 1) - 1];
+}
+
+// Private: Replay state for one run
+class ReplayModel
+{
+    public:
+        ReplayModel(AT24CXX& eeprom, const ReplayConfig& config, ReplayReport& report)
+        : _eeprom(eeprom)
+        , _config(config)
+        , _report(report)
+        , _page_size(eeprom.pageSize())
+        , _scratch(eeprom.size(), 0)
+        , _now(0)
+        , _last(HAL::micros())
+        { }
+
+        // 64-bit virtual time, accumulated from 32-bit micros()
+        uint64_t now()
+        {
+            uint32_t t = HAL::micros();
+
+            _now  += (uint32_t)(t - _last);
+            _last  = t;
+
+            return _now;
+        }
+
+        void idleUntil(uint64_t t)
+        {
+            while (now() < t)
+                HAL::advanceClock((uint32_t)std::min<uint64_t>(t - _now, 0x7FFFFFFF));
+        }
+
+        // Commit pages whose window expired by time t, each at its expiry
+        void flushExpired(uint64_t t)
+        {
+            bool found = true;
+
+            while (found)
+            {
+                auto oldest = _pending.end();
+
+                for (auto it = _pending.begin(); it != _pending.end(); ++it)
+                {
+                    if ((oldest == _pending.end()) || (it->second.since < oldest->second.since))
+                        oldest = it;
+                }
+
+                found = (oldest != _pending.end()) && (oldest->second.since + _config.coalesce_us <= t);
+
+                if (found)
+                {
+                    idleUntil(oldest->second.since + _config.coalesce_us);
+                    flushPage(oldest->first);
+                }
+            }
+        }
+
+        void flushAll()
+        {
+            while (!_pending.empty())
+                flushPage(_pending.begin()->first);
+        }
+
+        bool write(uint16_t address, uint16_t len)
+        {
+            uint32_t end = (uint32_t)address + len;
+
+            if (!_config.coalesce_us || (end > _eeprom.size()))
+                return writeThrough(address, len);
+
+            for (uint32_t a = address; a < end; a++)
+            {
+                uint16_t     page  = (uint16_t)(a / _page_size);
+                auto         found = _pending.find(page);
+
+                if (found == _pending.end())
+                    found = _pending.emplace(page, PendingPage{ now(), std::vector<bool>(_page_size, false) }).first;
+
+                found->second.dirty[a % _page_size] = true;
+            }
+
+            return true;
+        }
+
+        bool read(uint16_t address, uint16_t len)
+        {
+            uint32_t end     = (uint32_t)address + len;
+            bool     covered = (end <= _eeprom.size()) && len;
+            bool     ok      = true;
+
+            // Reads observe pending writes; fully pending reads need no bus access
+            for (uint32_t a = address; covered && (a < end); a++)
+            {
+                auto found = _pending.find((uint16_t)(a / _page_size));
+                covered    = (found != _pending.end()) && found->second.dirty[a % _page_size];
+            }
+
+            if (covered)
+            {
+                _report.cached_reads++;
+                return true;
+            }
+
+            for (uint32_t p = address / _page_size; (p <= (end - 1) / _page_size) && (end <= _eeprom.size()); p++)
+            {
+                if (_pending.count((uint16_t)p))
+                    flushPage((uint16_t)p);
+            }
+
+            if (!_config.cache_pages || (end > _eeprom.size()) || !len)
+                return _eeprom.read(address, _scratch.data(), len);
+
+            covered = true;
+
+            for (uint32_t p = address / _page_size; p <= (end - 1) / _page_size; p++)
+            {
+                if (touch((uint16_t)p))
+                    continue;
+
+                covered = false;
+                ok      = _eeprom.read((uint16_t)(p * _page_size), _scratch.data(), _page_size) && ok;
+
+                if (ok)
+                    insert((uint16_t)p);
+            }
+
+            if (covered)
+                _report.cached_reads++;
+
+            return ok;
+        }
+
+    private:
+        bool writeThrough(uint16_t address, uint16_t len)
+        {
+            // Written data is known to the cache, so cached pages stay valid
+            return _eeprom.write(address, _scratch.data(), len);
+        }
+
+        void flushPage(uint16_t page)
+        {
+            std::vector<bool>& dirty = _pending[page].dirty;
+            uint16_t           lo    = 0;
+            uint16_t           hi    = _page_size;
+            bool               gaps  = false;
+            uint16_t           base  = (uint16_t)(page * _page_size);
+
+            while (!dirty[lo])
+                lo++;
+
+            while (!dirty[hi - 1])
+                hi--;
+
+            for (uint16_t i = lo; i < hi; i++)
+                gaps = gaps || !dirty[i];
+
+            // Bytes between merged writes are filled from the device unless the page is cached
+            if (gaps && !touch(page) && !_eeprom.read((uint16_t)(base + lo), _scratch.data(), hi - lo))
+                _report.errors++;
+
+            if (!_eeprom.write((uint16_t)(base + lo), _scratch.data(), hi - lo))
+                _report.errors++;
+
+            _pending.erase(page);
+        }
+
+        bool touch(uint16_t page)
+        {
+            auto found = _cached.find(page);
+
+            if (found == _cached.end())
+                return false;
+
+            _lru.splice(_lru.begin(), _lru, found->second);
+
+            return true;
+        }
+
+        void insert(uint16_t page)
+        {
+            if (_cached.size() >= _config.cache_pages)
+            {
+                _cached.erase(_lru.back());
+                _lru.pop_back();
+            }
+
+            _lru.push_front(page);
+            _cached[page] = _lru.begin();
+        }
+
+        AT24CXX&                                                  _eeprom;
+        const ReplayConfig&                                       _config;
+        ReplayReport&                                             _report;
+        uint16_t                                                  _page_size;
+        std::vector<uint8_t>                                      _scratch;
+        std::map<uint16_t, PendingPage>                           _pending;
+        std::list<uint16_t>                                       _lru;
+        std::unordered_map<uint16_t, std::list<uint16_t>::iterator> _cached;
+        uint64_t                                                  _now;
+        uint32_t                                                  _last;
+};
+
+
+TraceReplay::TraceReplay()
+: _chip(0)
+{ }
+
+bool TraceReplay::load(const char * path, std::string& error)
+{
+    static const uint32_t chips[] = { AT24C01, AT24C02, AT24C04, AT24C08, AT24C16, AT24C32, AT24C64, AT24C128,
+                                      AT24C256, AT24C512 };
+    FILE *           file = fopen(path, "rb");
+    uint8_t          header[AT24CXX_TRACE_HEADER_SIZE];
+    uint8_t          raw[AT24CXX_TRACE_EVENT_SIZE];
+    uint32_t         size;
+    EepromTraceEvent event;
+
+    _events.clear();
+    _chip = 0;
+
+    if (!file)
+    {
+        error = std::string("cannot open ") + path;
+        return false;
+    }
+
+    if ((1 != fread(header, sizeof(header), 1, file)) ||
+        ((uint32_t)(header[0] | (header[1] << 8) | (header[2] << 16) | ((uint32_t)header[3] << 24)) != AT24CXX_TRACE_MAGIC))
+    {
+        fclose(file);
+        error = std::string(path) + " is not a trace";
+        return false;
+    }
+
+    while (1 == fread(raw, sizeof(raw), 1, file))
+    {
+        EepromTraceBuffer::decode(raw, event);
+        _events.push_back(event);
+    }
+
+    fclose(file);
+
+    // Chip size uniquely identifies the part
+    size = (uint32_t)(header[4] | (header[5] << 8) | (header[6] << 16) | ((uint32_t)header[7] << 24));
+
+    for (uint32_t c : chips)
+    {
+        if ((c & 0x0001FFFF) == size)
+            _chip = c;
+    }
+
+    if (!_chip)
+    {
+        error = "unknown chip size " + std::to_string(size);
+        return false;
+    }
+
+    return true;
+}
+
+bool TraceReplay::run(const ReplayConfig& config, ReplayReport& report, std::string& error)
+{
+    char                  path[] = "/tmp/tracereplay-XXXXXX";
+    int                   fd     = mkstemp(path);
+    std::vector<uint32_t> latencies;
+    uint64_t              arrival = 0;
+
+    report = ReplayReport{};
+
+    if (fd < 0)
+    {
+        error = "cannot create emulation image";
+        return false;
+    }
+
+    close(fd);
+
+    HAL::MappedEeprom emulator(path);
+
+    emulator.addDevice(_chip);
+
+    if (!emulator.open(error))
+    {
+        unlink(path);
+        return false;
+    }
+
+    unlink(path);
+    emulator.setWriteCycleUs(config.write_cycle_us);
+    HAL::setVirtualClock(true);
+
+    HAL::I2C    bus(emulator);
+    AT24CXX     eeprom(bus, _chip);
+    ReplayModel model(eeprom, config, report);
+
+    bus.setBusHz(config.bus_hz);
+    eeprom.init();
+
+    HAL::setDelayHook([&](uint32_t ms)
+    {
+        uint64_t start = model.now();
+        uint8_t  reg   = 0;
+
+        if (!config.ack_polling)
+        {
+            HAL::advanceClock(ms * 1000);
+        }
+        else
+        {
+            // Zero-length write of the word address; each NACK costs one address byte on the bus
+            while (0 != ((eeprom.size() > 2048) ? bus.write(0x50, (uint16_t)0, &reg, 0) : bus.write(0x50, reg, &reg, 0)))
+            {
+                if (!config.bus_hz)
+                    HAL::advanceClock(10);
+            }
+        }
+
+        report.wait_us += model.now() - start;
+    });
+
+    latencies.reserve(_events.size());
+
+    for (size_t i = 0; i < _events.size(); i++)
+    {
+        const EepromTraceEvent& event = _events[i];
+        bool                    ok;
+
+        if (i)
+            arrival += (uint32_t)(event.timestamp_us - _events[i - 1].timestamp_us);
+
+        model.flushExpired(arrival);
+        model.idleUntil(arrival);
+
+        ok = (EEPROM_TRACE_WRITE == event.op) ? model.write(event.address, event.len)
+                                              : model.read(event.address, event.len);
+
+        if (!ok)
+            report.errors++;
+
+        latencies.push_back((uint32_t)std::min<uint64_t>(model.now() - arrival, UINT32_MAX));
+    }
+
+    model.flushAll();
+
+    HAL::setDelayHook(nullptr);
+
+    std::sort(latencies.begin(), latencies.end());
+
+    report.ops          = (uint32_t)_events.size();
+    report.bus_time_us  = bus.busTimeUs();
+    report.write_cycles = emulator.stats().writes;
+    report.p50_us       = percentile(latencies, 50);
+    report.p99_us       = percentile(latencies, 99);
+    report.max_us       = latencies.empty() ? 0 : latencies.back();
+
+    return true;
+}
+
+ReplayReport TraceReplay::recorded() const
+{
+    ReplayReport          report{};
+    std::vector<uint32_t> durations;
+
+    for (const EepromTraceEvent& event : _events)
+    {
+        durations.push_back(event.duration_us);
+
+        if (!event.ok)
+            report.errors++;
+    }
+
+    std::sort(durations.begin(), durations.end());
+
+    report.ops    = (uint32_t)_events.size();
+    report.p50_us = percentile(durations, 50);
+    report.p99_us = percentile(durations, 99);
+    report.max_us = durations.empty() ? 0 : durations.back();
+
+    return report;
+}
+
+}
+
+// EOF
@@ -0,0 +1,109 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : trace_replay.h
+// Purpose     : AT24CXX Trace Replay Harness
+// Description :
+//               Replays a trace recorded with at24cxx_trace.h against an emulated device (mapped_eeprom.h) on the
+//               virtual clock, so that driver configurations can be compared on real workloads in seconds. Events
+//               are issued at their recorded arrival times through the unmodified driver, with each transfer
+//               charged at the configured SCL rate and the device taking a configurable write cycle time.
+//
+//               Configurations model:
+//
+//               - A page-granular LRU read cache, write-through: reads of cached pages cost no bus time, and
+//                 misses fetch whole pages.
+//               - Write coalescing: writes are held per page for a time window, merged, and committed as one
+//                 write per page when the window expires or the page is read.
+//               - Acknowledge polling: the driver's fixed write cycle delays are replaced by polling the device
+//                 until it acknowledges, so waits follow the device's actual write cycle time.
+//
+//               Each run reports bus time, time spent waiting on write cycles, write cycles performed and the
+//               latency distribution of calls, measured from recorded arrival to completion; queueing behind
+//               earlier calls is therefore included.
+//
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+// Requires    : External : N/A
+//               Custom   : hal.h - Hosted Linux HAL (host/hal.h)
+//--------------------------------------------------------------------------------------------------------------------
+#ifndef _TRACE_REPLAY_H
+#define _TRACE_REPLAY_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "at24cxx_trace.h"
+
+namespace PeripheralIO
+{
+
+struct ReplayConfig
+{
+    uint32_t bus_hz;         // SCL rate
+    uint32_t write_cycle_us; // device write cycle time; the driver waits a fixed 5 ms unless polling
+    uint16_t cache_pages;    // LRU read cache capacity; 0 disables
+    uint32_t coalesce_us;    // write coalescing window; 0 writes through
+    bool     ack_polling;
+};
+
+struct ReplayReport
+{
+    uint32_t ops;
+    uint32_t errors;         // calls returning false
+    uint32_t cached_reads;   // reads completed without bus access
+    uint64_t bus_time_us;
+    uint64_t wait_us;        // time in write cycle delays or polling
+    uint64_t write_cycles;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+};
+
+class TraceReplay
+{
+    public:
+        TraceReplay();
+
+        /**
+         * @brief Load serialized trace
+         * @param path Path of trace file
+         * @param error Out: description of failure
+         * @return False for unreadable or malformed trace or unknown chip, true otherwise
+        */
+        bool load(const char * path, std::string& error);
+
+        /**
+         * @brief Replay loaded trace under a configuration
+         * @param config Configuration to model
+         * @param report Out: measurements
+         * @param error Out: description of failure
+         * @return False if the emulated device cannot be created, true otherwise
+        */
+        bool run(const ReplayConfig& config, ReplayReport& report, std::string& error);
+
+        /**
+         * @brief Summarize call durations as recorded in the field; bus and wait figures are not available
+        */
+        ReplayReport recorded() const;
+
+        /**
+         * @brief Get chip selection constant of the traced device
+        */
+        uint32_t chip() const { return _chip; }
+
+        /**
+         * @brief Get loaded events
+        */
+        const std::vector<EepromTraceEvent>& events() const { return _events; }
+
+    private:
+        std::vector<EepromTraceEvent> _events;
+        uint32_t                      _chip;
+};
+
+}
+
+#endif // _TRACE_REPLAY_H
+
+// EOF
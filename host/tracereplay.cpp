@@ -0,0 +1,126 @@
+//--------------------------------------------------------------------------------------------------------------------
+// Name        : tracereplay.cpp
+// Purpose     : AT24CXX Trace Replay Command Line Tool
+// Description :
+//               Replays a recorded trace under one configuration, or under a sweep of cache, coalescing and
+//               polling configurations, and prints one line of measurements per configuration after the latencies
+//               recorded in the field.
+//
+//               Usage: tracereplay [-b bus_hz] [-t write_cycle_us] [-c pages] [-w coalesce_us] [-a] [-s] <trace>
+//                      -b bus_hz          SCL rate (default 400000)
+//                      -t write_cycle_us  device write cycle time (default 3500)
+//                      -c pages           LRU read cache pages (default 0)
+//                      -w coalesce_us     write coalescing window (default 0)
+//                      -a                 acknowledge polling instead of fixed write cycle delays
+//                      -s                 sweep cache {0, 8, 32}, coalescing {0, 20 ms} and polling {off, on}
+//
+// Language    : C++17
+// Platform    : Linux
+// Framework   : POSIX
+// Copyright   : MIT License 2024, John Greenwell
+//--------------------------------------------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+#include "trace_replay.h"
+
+using namespace PeripheralIO;
+
+static void printRow(const char * label, const ReplayReport& r, bool measured)
+{
+    if (measured)
+    {
+        printf("%-22s %8u %6u %8u %10.1f %10.1f %8llu %8u %8u %8u\n", label, r.ops, r.errors, r.cached_reads,
+               r.bus_time_us / 1000.0, r.wait_us / 1000.0, (unsigned long long)r.write_cycles, r.p50_us, r.p99_us,
+               r.max_us);
+    }
+    else
+    {
+        printf("%-22s %8u %6u %8s %10s %10s %8s %8u %8u %8u\n", label, r.ops, r.errors, "-", "-", "-", "-", r.p50_us,
+               r.p99_us, r.max_us);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    ReplayConfig              base{ 400000, 3500, 0, 0, false };
+    std::vector<ReplayConfig> configs;
+    TraceReplay               replay;
+    ReplayReport              report;
+    std::string               error;
+    bool                      sweep = false;
+    int                       opt;
+
+    while ((opt = getopt(argc, argv, "b:t:c:w:as")) != -1)
+    {
+        if ('b' == opt)
+            base.bus_hz = (uint32_t)strtoul(optarg, nullptr, 0);
+        else if ('t' == opt)
+            base.write_cycle_us = (uint32_t)strtoul(optarg, nullptr, 0);
+        else if ('c' == opt)
+            base.cache_pages = (uint16_t)strtoul(optarg, nullptr, 0);
+        else if ('w' == opt)
+            base.coalesce_us = (uint32_t)strtoul(optarg, nullptr, 0);
+        else if ('a' == opt)
+            base.ack_polling = true;
+        else if ('s' == opt)
+            sweep = true;
+        else
+            return 2;
+    }
+
+    if (optind + 1 != argc)
+    {
+        fprintf(stderr, "usage: %s [-b bus_hz] [-t write_cycle_us] [-c pages] [-w coalesce_us] [-a] [-s] <trace>\n",
+                argv[0]);
+        return 2;
+    }
+
+    if (!replay.load(argv[optind], error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    if (sweep)
+    {
+        for (uint16_t cache : { 0, 8, 32 })
+        {
+            for (uint32_t window : { 0, 20000 })
+            {
+                for (bool polling : { false, true })
+                    configs.push_back(ReplayConfig{ base.bus_hz, base.write_cycle_us, cache, window, polling });
+            }
+        }
+    }
+    else
+    {
+        configs.push_back(base);
+    }
+
+    printf("%-22s %8s %6s %8s %10s %10s %8s %8s %8s %8s\n", "config", "ops", "errors", "cached", "bus_ms", "wait_ms",
+           "cycles", "p50_us", "p99_us", "max_us");
+    printRow("recorded", replay.recorded(), false);
+
+    for (const ReplayConfig& config : configs)
+    {
+        char label[64];
+
+        snprintf(label, sizeof(label), "c=%u w=%u %s", config.cache_pages, config.coalesce_us,
+                 config.ack_polling ? "poll" : "fixed");
+
+        if (!replay.run(config, report, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+
+        printRow(label, report, true);
+    }
+
+    return 0;
+}
+
+// EOF